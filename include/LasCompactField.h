@@ -0,0 +1,143 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASCOMPACTFIELD_H
+#define LASCOMPACTFIELD_H
+
+#include "LasDetails.h"
+
+#include <QMetaType>
+#include <QSharedPointer>
+
+#include <cstdint>
+#include <vector>
+
+class ccScalarField;
+
+/// Values of an integer LAS field stored with the width of the field
+/// (e.g. 1 bit for the flags, 1 byte for the classification, 2 bytes for the intensity),
+/// instead of one ScalarType per point as in a ccScalarField.
+///
+/// Values are only widened to ScalarType when they are read,
+/// or when the field is turned into a ccScalarField.
+///
+/// While values are set, the field keeps track of how many differ from the first one:
+/// a constant field is stored as a single value, a field where few points differ
+/// is stored as index/value pairs, and the per point storage is only allocated
+/// once these pairs would take more than half of its memory.
+class LasCompactField
+{
+  public:
+    /// Returns whether the values of the field are integers that can be stored compactly.
+    static bool IsSupported(LasScalarField::Id id);
+
+    /// Returns the number of bytes a value of the field takes once the per point storage is allocated.
+    static double BytesPerValue(LasScalarField::Id id);
+
+    /// How the values are stored
+    enum class Layout
+    {
+        /// All the points have the same value
+        Constant,
+        /// The points that differ from the value of the first one are stored as index/value pairs
+        Sparse,
+        /// One value per point
+        Dense
+    };
+
+    /// Creates the storage for `numPoints` values of the field, all set to 0.
+    LasCompactField(LasScalarField::Id id, unsigned int numPoints);
+
+    LasScalarField::Id id() const
+    {
+        return m_id;
+    }
+
+    const char *name() const;
+
+    unsigned int size() const
+    {
+        return m_size;
+    }
+
+    Layout layout() const
+    {
+        return m_layout;
+    }
+
+    /// Returns the number of bytes used to store the values.
+    size_t memoryUsage() const;
+
+    /// Sets the value of a point, points must be set in increasing index order.
+    ///
+    /// Throws std::bad_alloc if the storage has to grow and there is not enough memory.
+    void setValue(unsigned int index, int32_t value);
+    ScalarType getValue(unsigned int index) const;
+
+    /// Only keeps the first `numPoints` values.
+    void resize(unsigned int numPoints);
+
+    /// Creates a ccScalarField holding the widened values.
+    ///
+    /// Returns nullptr if there is not enough memory.
+    ccScalarField *toScalarField() const;
+
+  private:
+    enum class Storage
+    {
+        /// 8 points per byte, for the flags
+        Bit,
+        Int8,
+        UInt8,
+        UInt16
+    };
+
+    struct SparseValue
+    {
+        unsigned int index;
+        int32_t value;
+    };
+
+    /// Returns the storage that fits the range of values of the field.
+    static Storage StorageFor(LasScalarField::Id id);
+
+    /// Returns the number of bytes needed to store the values of `numPoints` points.
+    static size_t DataSize(Storage storage, unsigned int numPoints);
+
+    void setDenseValue(unsigned int index, int32_t value);
+    ScalarType getDenseValue(unsigned int index) const;
+
+    /// Allocates the per point storage and moves the sparse values into it.
+    void densify();
+
+  private:
+    LasScalarField::Id m_id;
+    Storage m_storage;
+    unsigned int m_size;
+    Layout m_layout{Layout::Constant};
+    /// Value of all the points (constant) or of the points that have no sparse value
+    int32_t m_commonValue{0};
+    /// Sorted by index
+    std::vector<SparseValue> m_sparseValues;
+    std::vector<uint8_t> m_data;
+};
+
+/// The compact fields of a point cloud, stored in its meta data.
+using LasCompactFields = std::vector<LasCompactField>;
+
+Q_DECLARE_METATYPE(QSharedPointer<LasCompactFields>);
+
+#endif // LASCOMPACTFIELD_H
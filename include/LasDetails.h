@@ -18,9 +18,12 @@
 #define LASDETAILS_H
 
 #include <CCTypes.h>
+#include <QtEndian>
 #include <QtGlobal>
 
 #include <cmath>
+#include <cstdint>
+#include <cstring>
 #include <limits>
 #include <string>
 #include <vector>
@@ -31,6 +34,7 @@ class ccScalarField;
 class QDataStream;
 
 struct laszip_header;
+struct laszip_point;
 struct laszip_vlr;
 typedef laszip_vlr laszip_vlr_struct;
 
@@ -131,6 +135,9 @@ struct LasScalarField
     constexpr static const char *NameFromId(LasScalarField::Id id);
     static LasScalarField::Id IdFromName(const char *name, unsigned int targetPointFormat);
     static LasScalarField::Range ValueRange(LasScalarField::Id id);
+    /// Returns the value of the field `id` of the point,
+    /// as it is stored in CloudCompare's scalar fields (e.g. the scan angle is scaled).
+    static double ValueFrom(LasScalarField::Id id, const laszip_point &point);
 
     // TODO They should be private
   public: // Members
@@ -279,6 +286,11 @@ uint16_t PointFormatSize(unsigned int pointFormat);
 /// Returns the header size for the given minor version of the standard used
 uint16_t HeaderSize(unsigned int versionMinor);
 
+/// Returns the number of points the header says the file contains.
+///
+/// For LAS 1.4 the extended (64 bit) count is used.
+uint64_t PointCount(const laszip_header &header);
+
 /// Returns whether the point format supports Gps Time
 inline bool HasGpsTime(unsigned int pointFormatId)
 {
@@ -314,6 +326,13 @@ bool isLaszipVlr(const laszip_vlr_struct &);
 /// Returns whether the vlr describes extra bytes.
 bool isExtraBytesVlr(const laszip_vlr_struct &);
 
+/// Returns the laszip layers (`laszip_DECOMPRESS_SELECTIVE_*`) that have to be decompressed
+/// to load the given fields from a LAS 1.4 layered LAZ file.
+///
+/// RGB and wave packets are always part of it, as they are always loaded when present.
+uint32_t LayersToDecompress(const std::vector<LasScalarField> &fields,
+                            const std::vector<LasExtraScalarField> &extraFields);
+
 /// Header part of a LAS Extended VLR
 /// 
 /// In a LAS file, EVLRs are stored after the points.
@@ -341,6 +360,101 @@ struct EvlrHeader
 };
 
 
+/// The wave packet of a point (point formats 4, 5, 9 and 10),
+/// stored as 29 little endian bytes in the point record.
+struct LasWavePacket
+{
+    static constexpr size_t SIZE = 29;
+
+    uint8_t descriptorIndex{0};
+    uint64_t byteOffset{0};
+    uint32_t byteCount{0};
+    float returnPointLocation{0.0f};
+    float xt{0.0f};
+    float yt{0.0f};
+    float zt{0.0f};
+
+    static LasWavePacket Decode(const uint8_t *data)
+    {
+        LasWavePacket packet;
+        packet.descriptorIndex = data[0];
+        packet.byteOffset = qFromLittleEndian<quint64>(data + 1);
+        packet.byteCount = qFromLittleEndian<quint32>(data + 9);
+        packet.returnPointLocation = DecodeFloat(data + 13);
+        packet.xt = DecodeFloat(data + 17);
+        packet.yt = DecodeFloat(data + 21);
+        packet.zt = DecodeFloat(data + 25);
+        return packet;
+    }
+
+    void encode(uint8_t *data) const
+    {
+        data[0] = descriptorIndex;
+        qToLittleEndian<quint64>(byteOffset, data + 1);
+        qToLittleEndian<quint32>(byteCount, data + 9);
+        EncodeFloat(returnPointLocation, data + 13);
+        EncodeFloat(xt, data + 17);
+        EncodeFloat(yt, data + 21);
+        EncodeFloat(zt, data + 25);
+    }
+
+  private:
+    static float DecodeFloat(const uint8_t *data)
+    {
+        const quint32 bits = qFromLittleEndian<quint32>(data);
+        float value;
+        memcpy(&value, &bits, sizeof(float));
+        return value;
+    }
+
+    static void EncodeFloat(float value, uint8_t *data)
+    {
+        quint32 bits;
+        memcpy(&bits, &value, sizeof(float));
+        qToLittleEndian<quint32>(bits, data);
+    }
+};
+
+/// Byte ranges of waveform data referenced by waveforms.
+///
+/// Used to only keep the data that is actually referenced: ranges are merged
+/// when they overlap or are contiguous, and once the merged ranges are copied one after
+/// the other, `compactedOffset` gives the new offset of a waveform's data.
+class WaveformDataRanges
+{
+  public:
+    /// A range [begin, end) of the original data, and where it starts in the compacted data.
+    struct Range
+    {
+        uint64_t begin;
+        uint64_t end;
+        uint64_t compactedStart;
+    };
+
+    /// Adds the range of data of a waveform, `merge` must be called once all ranges are added.
+    void add(uint64_t byteOffset, uint32_t byteCount);
+
+    /// Sorts and merges the ranges that were added.
+    void merge();
+
+    /// Returns the offset that the data at `byteOffset` in the original data
+    /// has in the compacted data.
+    ///
+    /// `byteOffset` must be within one of the ranges that were added.
+    uint64_t compactedOffset(uint64_t byteOffset) const;
+
+    /// Returns the total size of the merged ranges.
+    uint64_t compactedSize() const;
+
+    const std::vector<Range> &ranges() const
+    {
+        return m_ranges;
+    }
+
+  private:
+    std::vector<Range> m_ranges;
+};
+
 /// See `SelectBestVersion`
 struct LasVersion
 {
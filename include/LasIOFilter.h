@@ -19,6 +19,9 @@
 
 #include "FileIOFilter.h"
 
+class ccPointCloud;
+class LasPlaceholder;
+
 class LasIOFilter : public FileIOFilter
 {
   public:
@@ -31,4 +34,31 @@ class LasIOFilter : public FileIOFilter
     bool canSave(CC_CLASS_ENUM type, bool &multiple, bool &exclusive) const override;
     CC_FILE_ERROR
     saveToFile(ccHObject *entity, const QString &filename, const SaveParameters &parameters) override;
+
+    /// Re-reads one field (standard or extra bytes) of the LAS file the point cloud
+    /// was loaded from into a new scalar field of the cloud,
+    /// without reloading the rest of the file.
+    ///
+    /// This is only valid if the cloud still has the points of the file in the same order,
+    /// which is checked against the number of points stored when the file was loaded.
+    static CC_FILE_ERROR
+    ReloadField(ccPointCloud &pointCloud, const QString &fileName, const QString &fieldName);
+
+    /// Returns the names of the fields of the cloud whose scalar fields are not created yet,
+    /// that is the fields in compact storage and the ones created on demand.
+    static QStringList PendingFieldNames(const ccPointCloud &pointCloud);
+
+    /// Creates the scalar field of a field that was loaded in compact storage
+    /// or that is created on demand, the compact values are then released
+    /// (the point records once all the fields created on demand are).
+    ///
+    /// This is what the "LAS" menu of the main window does.
+    /// When the cloud is saved, the pending fields are only created for the time of the save.
+    static CC_FILE_ERROR MaterializeField(ccPointCloud &pointCloud, const QString &fieldName);
+
+    /// Loads the points of the file of a placeholder (created from the header of the file only)
+    /// into the given empty cloud, which is meant to replace the placeholder.
+    ///
+    /// This is what the "LAS" menu of the main window does.
+    static CC_FILE_ERROR LoadPlaceholderPoints(const LasPlaceholder &placeholder, ccPointCloud &pointCloud);
 };
@@ -0,0 +1,56 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASMEMORYESTIMATE_H
+#define LASMEMORYESTIMATE_H
+
+#include "LasDetails.h"
+
+#include <QtGlobal>
+
+#include <laszip/laszip_api.h>
+
+#include <cstdint>
+#include <vector>
+
+/// How the fields of a file are stored once loaded
+struct LasStorageOptions
+{
+    /// Integer fields are kept in compact storage
+    bool compactStorage{false};
+    /// The fields not in compact storage are created on demand from the point records
+    bool fieldsOnDemand{false};
+    bool waveforms{false};
+};
+
+/// Returns an estimate of the number of bytes one loaded point uses in memory:
+/// its coordinates, color, waveform and the values of the given fields.
+///
+/// The waveform data packets are not included, as their size does not depend on the number of points.
+double EstimatedBytesPerPoint(const laszip_header &header,
+                              const std::vector<LasScalarField> &fields,
+                              const std::vector<LasExtraScalarField> &extraFields,
+                              const LasStorageOptions &options);
+
+/// Returns the number of points per second loaded on this machine, as measured in previous loads.
+///
+/// Returns 0 if no load was measured yet.
+double MeasuredLoadThroughput(bool isCompressed);
+
+/// Records the throughput of a load in the settings, averaged with the previous ones.
+void RecordLoadThroughput(bool isCompressed, uint64_t numPoints, qint64 elapsedMs);
+
+#endif // LASMEMORYESTIMATE_H
@@ -31,6 +31,8 @@
 #include <CCGeom.h>
 #include <ccLog.h>
 
+#include <laszip/laszip_api.h>
+
 //! Dialog to choose the LAS fields to load
 class LasOpenDialog : public QDialog, public Ui::LASOpenDialog
 {
@@ -45,12 +47,86 @@ class LasOpenDialog : public QDialog, public Ui::LASOpenDialog
     void setAvailableScalarFields(const std::vector<LasScalarField> &scalarFields,
                                   const std::vector<LasExtraScalarField> &extraScalarFields);
 
+    /// Sets what is needed to estimate the memory and the time the load takes,
+    /// the estimates are then updated as the fields and options are changed.
+    ///
+    /// Must be called after `setAvailableScalarFields`.
+    void setEstimateInfo(const laszip_header &header, bool isCompressed);
+
+    /// Sets the file whose points are sampled when the user asks for a preview.
+    void setPreviewFileName(const QString &fileName);
+
     void filterOutNotChecked(std::vector<LasScalarField> &scalarFields,
                              std::vector<LasExtraScalarField> &extraScalarFields);
 
     bool isChecked(const LasScalarField &lasScalarField) const;
 
     bool isChecked(const LasExtraScalarField &lasExtraScalarField) const;
+
+    /// Returns whether the field with the given name is listed in the dialog
+    /// and was unchecked by the user.
+    ///
+    /// Contrary to `isChecked`, fields that are not listed are not considered
+    /// unchecked, this is used for fields that only exist in files to merge.
+    bool isUnchecked(const char *name) const;
+
+    /// Returns the files the user wants to merge with the file being opened.
+    QStringList filesToMerge() const;
+
+    /// Returns the name of the field the loaded cloud should be split by.
+    ///
+    /// Returns an empty string if the cloud should not be split.
+    QString splitFieldName() const;
+
+    /// Returns whether integer fields should be kept in compact storage
+    /// rather than loaded into scalar fields.
+    ///
+    /// This option, and the ones below, are disabled (and thus false, 0 or all the points)
+    /// when files are merged or the cloud is split.
+    bool shouldUseCompactStorage() const;
+
+    /// Returns whether the scalar fields should only be created when requested,
+    /// the point records being kept until then.
+    bool shouldCreateFieldsOnDemand() const;
+
+    /// Returns whether a coarse cloud should be shown first,
+    /// the remaining points being loaded by batches from the event loop.
+    bool shouldLoadProgressively() const;
+
+    /// Returns whether only the header should be read,
+    /// the points being loaded when the cloud is first used.
+    bool shouldDeferLoading() const;
+
+    /// Returns the number of bytes the loaded cloud should fit in.
+    ///
+    /// Returns 0 if there is no budget.
+    uint64_t memoryBudget() const;
+
+    /// Returns the index of the first point to load.
+    uint64_t firstPointToLoad() const;
+
+    /// Returns the index after the last point to load,
+    /// which is the number of points of the file if all the points are loaded.
+    uint64_t lastPointToLoad() const;
+
+  private:
+    void addFilesToMerge();
+    void removeSelectedFilesToMerge();
+    /// Disables the options that only apply to the loading of a single file into a single cloud
+    /// when files are merged or the cloud is split, so that they cannot be silently ignored.
+    void updateSingleCloudOptions();
+    void updateEstimates();
+    void showPreview();
+
+  private:
+    std::vector<LasScalarField> m_scalarFields;
+    std::vector<LasExtraScalarField> m_extraScalarFields;
+    /// Only the point format and the record length are set, which is what the estimate uses
+    laszip_header m_header{};
+    /// Number of points of the file
+    uint64_t m_numPoints{0};
+    bool m_isCompressed{false};
+    QString m_previewFileName;
 };
 
 #endif // CC_LAS_OPEN_DIALOG
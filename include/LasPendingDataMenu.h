@@ -0,0 +1,33 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+
+#ifndef LASPENDINGDATAMENU_H
+#define LASPENDINGDATAMENU_H
+
+/// "LAS" menu of the main window, to load what the plugin left pending in the selected entities:
+/// the fields in compact storage or created on demand of clouds, and the points of placeholders.
+///
+/// IO plugins are not given access to the main window, so the menu is added to the menu bar
+/// of the top level window that implements ccMainAppInterface, the first time something
+/// pending is loaded. There is no such window in command line mode.
+namespace LasPendingDataMenu
+{
+/// Adds the menu to the main window if it is not already there.
+void Install();
+} // namespace LasPendingDataMenu
+
+#endif // LASPENDINGDATAMENU_H
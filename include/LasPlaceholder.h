@@ -0,0 +1,94 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+
+#ifndef LASPLACEHOLDER_H
+#define LASPLACEHOLDER_H
+
+#include "LasDetails.h"
+#include "LasSavedInfo.h"
+
+#include <ccBBox.h>
+#include <ccCustomObject.h>
+
+#include <QString>
+
+#include <vector>
+
+/// Entity standing for a file of which only the header was read.
+///
+/// It is not a point cloud, so that CloudCompare's tools cannot be run on stand-in points:
+/// it only displays the bounding box of the file, and holds what is needed to load its points
+/// into a cloud that replaces it, which is done from the "LAS" menu.
+class LasPlaceholder : public ccCustomHObject
+{
+  public:
+    /// The box is in the local coordinates, that is with the shift applied.
+    LasPlaceholder(const QString &fileName,
+                   const ccBBox &box,
+                   const CCVector3d &shift,
+                   std::vector<LasScalarField> standardFields,
+                   std::vector<LasExtraScalarField> extraFields,
+                   LasSavedInfo savedInfo);
+
+    const QString &fileName() const
+    {
+        return m_fileName;
+    }
+
+    /// The global shift to give to the loaded cloud
+    const CCVector3d &shift() const
+    {
+        return m_shift;
+    }
+
+    /// The fields the user chose to load
+    const std::vector<LasScalarField> &standardFields() const
+    {
+        return m_standardFields;
+    }
+
+    const std::vector<LasExtraScalarField> &extraFields() const
+    {
+        return m_extraFields;
+    }
+
+    const LasSavedInfo &savedInfo() const
+    {
+        return m_savedInfo;
+    }
+
+    // Inherited from ccHObject
+    ccBBox getOwnBB(bool withGLFeatures = false) override;
+    /// The placeholder only stands for the file during the session
+    bool isSerializable() const override
+    {
+        return false;
+    }
+
+  protected:
+    void drawMeOnly(CC_DRAW_CONTEXT &context) override;
+
+  private:
+    QString m_fileName;
+    ccBBox m_box;
+    CCVector3d m_shift;
+    std::vector<LasScalarField> m_standardFields;
+    std::vector<LasExtraScalarField> m_extraFields;
+    LasSavedInfo m_savedInfo;
+};
+
+#endif // LASPLACEHOLDER_H
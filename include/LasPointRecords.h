@@ -0,0 +1,111 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASPOINTRECORDS_H
+#define LASPOINTRECORDS_H
+
+#include "LasDetails.h"
+
+#include <QMetaType>
+#include <QSharedPointer>
+#include <QTemporaryFile>
+
+#include <laszip/laszip_api.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// The point records of a LAS file, kept as they were decoded so that
+/// scalar fields can be created from them later rather than when the file is loaded.
+///
+/// Only the parts of the records that are not loaded into the cloud itself are kept
+/// (that is, everything but X, Y, Z, RGB and the wave packet), followed by the extra bytes.
+///
+/// The records are stored in memory if possible, otherwise in a memory mapped temporary file.
+class LasPointRecords
+{
+  public:
+    explicit LasPointRecords(const laszip_header &header);
+
+    /// Returns the number of bytes used to store the record of one point.
+    static size_t RecordSize(const laszip_header &header);
+
+    LasPointRecords(const LasPointRecords &) = delete;
+    LasPointRecords &operator=(const LasPointRecords &) = delete;
+
+    /// Allocates the storage for `numPoints` records.
+    ///
+    /// Returns false if neither the memory nor a temporary file could hold them.
+    bool allocate(unsigned int numPoints);
+
+    unsigned int size() const
+    {
+        return m_size;
+    }
+
+    /// Returns the number of bytes the records use.
+    size_t byteSize() const
+    {
+        return m_recordSize * static_cast<size_t>(m_size);
+    }
+
+    /// Returns whether the records are stored in a temporary file instead of in memory.
+    bool isFileBacked() const
+    {
+        return m_file != nullptr;
+    }
+
+    /// Stores the record of the point at the given index.
+    void store(unsigned int index, const laszip_point &point);
+
+    /// Fills the fields of the point from the record at the given index.
+    ///
+    /// The extra bytes of the point point into the records and must not be written.
+    void restore(unsigned int index, laszip_point &point) const;
+
+    /// Only keeps the first `numPoints` records.
+    void resize(unsigned int numPoints);
+
+  private:
+    unsigned int m_pointFormat;
+    /// Size of the standard part of a record
+    size_t m_coreSize;
+    size_t m_numExtraBytes;
+    size_t m_recordSize;
+    unsigned int m_size{0};
+    std::vector<uint8_t> m_data;
+    std::unique_ptr<QTemporaryFile> m_file;
+    /// Either the data of m_data or the mapping of m_file
+    uint8_t *m_records{nullptr};
+};
+
+/// Fields of a cloud whose scalar fields are only created when requested,
+/// along with the records they are created from. Stored in the meta data of the cloud.
+struct LasDeferredFields
+{
+    explicit LasDeferredFields(const laszip_header &header) : records(header)
+    {
+    }
+
+    LasPointRecords records;
+    std::vector<LasScalarField> standardFields;
+    std::vector<LasExtraScalarField> extraFields;
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<LasDeferredFields>);
+
+#endif // LASPOINTRECORDS_H
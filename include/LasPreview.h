@@ -0,0 +1,62 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASPREVIEW_H
+#define LASPREVIEW_H
+
+#include <FileIOFilter.h>
+
+#include <QString>
+
+#include <map>
+#include <vector>
+
+/// What the fields of a file look like, computed from a sample of its points
+/// so that it can be shown before the whole file is loaded.
+struct LasPreview
+{
+    /// Range of the sampled values of a (standard or extra) field
+    struct FieldRange
+    {
+        QString name;
+        double min{0.0};
+        double max{0.0};
+
+        bool isAllZero() const
+        {
+            return min == 0.0 && max == 0.0;
+        }
+    };
+
+    /// Reads `numRuns` runs of `runLength` consecutive points, spread evenly through the file.
+    ///
+    /// Runs are used rather than single points as, in a LAZ file,
+    /// each seek decompresses the chunk from its start up to the point.
+    static CC_FILE_ERROR Compute(const QString &fileName,
+                                 LasPreview &preview,
+                                 unsigned int numRuns = 64,
+                                 unsigned int runLength = 64);
+
+    unsigned int numSampledPoints{0};
+    std::vector<FieldRange> fieldRanges;
+    /// Number of sampled points per classification
+    std::map<int, unsigned int> classificationCounts;
+    bool hasRGB{false};
+    /// Whether the color components use 16 bits, or only the lower 8
+    bool isRGB16Bits{false};
+};
+
+#endif // LASPREVIEW_H
@@ -0,0 +1,140 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASPROGRESSIVELOADER_H
+#define LASPROGRESSIVELOADER_H
+
+#include "LasDetails.h"
+#include "LasScalarFieldLoader.h"
+
+#include <QMetaType>
+#include <QSharedPointer>
+
+#include <laszip/laszip_api.h>
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/// Loads a file in two steps, so that something is shown without waiting for the whole file:
+///
+/// 1. A coarse cloud made of runs of consecutive points spread evenly through the file
+///    (runs rather than single points as, in a LAZ file, each seek decompresses the chunk
+///    from its start up to the point).
+/// 2. The remaining points, appended to the same cloud by batches from the event loop,
+///    the display being refreshed after each batch.
+///
+/// The batches are read on the GUI thread, between two passes of the event loop,
+/// each of them only lasting a few tens of milliseconds, so the user can work with the cloud
+/// while it grows.
+///
+/// While the remaining points are loaded, the loader is kept in the meta data of the cloud,
+/// so that loading stops if the cloud is deleted, and it stops if the cloud was otherwise
+/// modified (points, colors or scalar fields removed).
+///
+/// The points of the cloud are not in the order of the file.
+class LasProgressiveLoader
+{
+  public:
+    /// The loader takes the ownership of the reader, which must be opened.
+    LasProgressiveLoader(laszip_POINTER laszipReader,
+                         const laszip_header &laszipHeader,
+                         laszip_point &laszipPoint,
+                         ccPointCloud &pointCloud,
+                         const CCVector3d &shift,
+                         std::vector<LasScalarField> fields,
+                         std::vector<LasExtraScalarField> extraFields);
+
+    LasProgressiveLoader(const LasProgressiveLoader &) = delete;
+    LasProgressiveLoader &operator=(const LasProgressiveLoader &) = delete;
+
+    ~LasProgressiveLoader();
+
+    /// Loads `numRuns` runs of `runLength` consecutive points into the cloud.
+    ///
+    /// Small files are loaded entirely.
+    CC_FILE_ERROR loadCoarse(unsigned int numRuns, unsigned int runLength);
+
+    /// Returns whether all the points of the file are loaded.
+    bool isDone() const
+    {
+        return m_isDone;
+    }
+
+    const LasScalarFieldLoader &fieldLoader() const
+    {
+        return *m_fieldLoader;
+    }
+
+    /// Sets the function called once all the points are loaded.
+    void setOnFinished(std::function<void(const LasScalarFieldLoader &)> onFinished)
+    {
+        m_onFinished = std::move(onFinished);
+    }
+
+    /// Loads the remaining points from the event loop.
+    static void LoadRemainingPoints(const QSharedPointer<LasProgressiveLoader> &loader);
+
+  private:
+    /// Returns whether the point at the given index of the file is part of the coarse cloud.
+    bool isInCoarseCloud(uint64_t index) const;
+
+    /// Returns whether the scalar fields being filled were not removed from the cloud.
+    bool scalarFieldsAreInCloud() const;
+
+    /// Returns whether the cloud is still as the loader left it after the last batch:
+    /// same number of points, colors (if any) and scalar fields.
+    bool cloudIsUnchanged() const;
+
+    void closeReader();
+
+    /// Appends the remaining points of the file, up to `end` (excluded), to the cloud.
+    CC_FILE_ERROR loadPoints(uint64_t end);
+
+    /// Appends the remaining points to the cloud for a short time, and refreshes its display.
+    CC_FILE_ERROR loadNextBatch();
+
+    static void ScheduleNextBatch(const QWeakPointer<LasProgressiveLoader> &weakLoader);
+
+    /// Releases the reader, and the loader itself once the caller drops its reference.
+    void finish();
+
+  private:
+    laszip_POINTER m_laszipReader;
+    laszip_point &m_laszipPoint;
+    uint64_t m_pointCount;
+    ccPointCloud &m_pointCloud;
+    CCVector3d m_shift;
+    std::vector<LasScalarField> m_fields;
+    std::vector<LasExtraScalarField> m_extraFields;
+    std::unique_ptr<LasScalarFieldLoader> m_fieldLoader;
+    std::function<void(const LasScalarFieldLoader &)> m_onFinished;
+    bool m_hasRGB{false};
+    /// Number of points and whether the cloud had colors when the last batch was loaded
+    unsigned int m_numLoadedPoints{0};
+    bool m_hadColors{false};
+
+    unsigned int m_numRuns{0};
+    unsigned int m_runLength{0};
+    uint64_t m_runStride{0};
+    /// Index, in the file, of the next point read by the refinement
+    uint64_t m_nextPointIndex{0};
+    bool m_isDone{false};
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<LasProgressiveLoader>);
+
+#endif // LASPROGRESSIVELOADER_H
@@ -44,12 +44,25 @@ class LasSaveDialog : public QDialog, public Ui::LASSaveDialog
     void setOptimalScale(const CCVector3d &optimalScale);
     void setSavedScale(const CCVector3d &savedScale);
     void setExtraScalarFields(const std::vector<LasExtraScalarField> &extraScalarFields);
+    /// Allows the user to only save the visible points.
+    void setHasVisibilityTable(bool hasVisibilityTable);
 
     unsigned int selectedPointFormat() const;
     unsigned int selectedVersionMinor() const;
     CCVector3d chosenScale() const;
     bool shouldSaveRGB() const;
     bool shouldSaveWaveform() const;
+    /// Returns whether the waveform data should be stored in an EVLR of the LAS file
+    /// rather than in an external .wdp file.
+    bool shouldSaveWaveformInternally() const;
+    /// Returns the name of the LAS field by which the points should be split into multiple files.
+    ///
+    /// Returns an empty string if all the points go into one file.
+    QString splitFieldName() const;
+    bool shouldSaveVisiblePointsOnly() const;
+    /// Returns whether LAZ files of point formats >= 6 should use
+    /// the native LAS 1.4 layered compression (laszip's default) rather than the compatibility mode.
+    bool shouldUseLayeredCompression() const;
 
     std::vector<LasScalarField> fieldsToSave() const;
 
@@ -53,6 +53,9 @@ struct LasSavedInfo
     double xScale{0.0};
     double yScale{0.0};
     double zScale{0.0};
+    /// Number of points of the file, used to check that a cloud
+    /// still has the points of the file before re-reading one of its fields.
+    uint64_t numPoints{0};
 
     laszip_U32 numVlrs{0};
     laszip_vlr_struct *vlrs{nullptr};
@@ -32,6 +32,13 @@
 /// from the LAS file into a ccPointCloud's scalar field.
 /// 
 /// This also handle LAS extra scalar fields, as well as RGB.
+///
+/// The point cloud is expected to be already sized to hold all the points,
+/// values are written at the given point index.
+///
+/// Fields (standard or extra) that already have their ccScalarField(s) set
+/// when given to the loader are written into these, which allows multiple loaders
+/// to fill disjoint parts of the same scalar fields.
 class LasScalarFieldLoader
 {
   public:
@@ -39,17 +46,45 @@ class LasScalarFieldLoader
                          std::vector<LasExtraScalarField> extraScalarFields,
                          ccPointCloud &pointCloud);
 
-    CC_FILE_ERROR handleScalarFields(ccPointCloud &pointCloud, const laszip_point &currentPoint);
-
-    CC_FILE_ERROR handleRGBValue(ccPointCloud &pointCloud, const laszip_point &currentPoint);
+    /// Loads the point the reader is on at the given index of the cloud:
+    /// its coordinates (to which the shift is added), its fields, and its color if `hasRGB`.
+    ///
+    /// This is what all the ways of loading points do for each point.
+    CC_FILE_ERROR loadPoint(laszip_POINTER laszipReader,
+                            const laszip_point &currentPoint,
+                            const CCVector3d &shift,
+                            bool hasRGB,
+                            ccPointCloud &pointCloud,
+                            unsigned int pointIndex);
+
+    /// Loads the standard and the extra fields of the point at the given index.
+    CC_FILE_ERROR
+    handleFields(ccPointCloud &pointCloud, unsigned int pointIndex, const laszip_point &currentPoint);
+
+    CC_FILE_ERROR
+    handleScalarFields(ccPointCloud &pointCloud, unsigned int pointIndex, const laszip_point &currentPoint);
+
+    /// Writes the color of the point into the color table of the cloud,
+    /// which is only allocated the first time a point is not black.
+    ///
+    /// The cloud is not notified, so that different loaders can write to the same
+    /// (already allocated) table concurrently: `colorsHaveChanged` has to be called
+    /// once the points are loaded if the cloud may already be displayed.
+    CC_FILE_ERROR
+    handleRGBValue(ccPointCloud &pointCloud, unsigned int pointIndex, const laszip_point &currentPoint);
 
-    CC_FILE_ERROR handleExtraScalarFields(ccPointCloud &pointCloud, const laszip_point &currentPoint);
+    CC_FILE_ERROR handleExtraScalarFields(unsigned int pointIndex, const laszip_point &currentPoint);
 
     const std::vector<LasScalarField> &standardFields() const
     {
         return m_standardFields;
     }
 
+    const std::vector<LasExtraScalarField> &extraFields() const
+    {
+        return m_extraScalarFields;
+    }
+
   private:
 
     /// Handles loading of LAS value into the scalar field that will be part
@@ -57,15 +92,22 @@ class LasScalarFieldLoader
     ///
     /// sfInfo: Info about the current scalar field we are loading the value into
     /// pointCloud: The point cloud where the scalar field will be loaded into
+    /// pointIndex: The index of the point the value belongs to
     /// currentValue: The current value of the LAS field we are loading.
     template <typename T>
-    CC_FILE_ERROR handleScalarField(LasScalarField &sfInfo, ccPointCloud &pointCloud, T currentValue);
+    CC_FILE_ERROR handleScalarField(LasScalarField &sfInfo,
+                                    ccPointCloud &pointCloud,
+                                    unsigned int pointIndex,
+                                    T currentValue);
 
-    /// Same thing as `handleScalarField` but for RGB.
+    /// Same thing as `handleScalarField` but for Gps Time.
     ///
-    /// In LAS files, the red, green and blue channels are normal LAS fiels,
-    /// however in CloudCompare RGB is handled differently.
-    CC_FILE_ERROR handleGpsTime(LasScalarField &sfInfo, ccPointCloud &pointCloud, double currentValue);
+    /// The first non-zero Gps Time is used as the scalar field's global shift
+    /// to preserve precision.
+    CC_FILE_ERROR handleGpsTime(LasScalarField &sfInfo,
+                                ccPointCloud &pointCloud,
+                                unsigned int pointIndex,
+                                double currentValue);
 
     /// creates the ccScalarFields that correspond to the LAS extra dimensions
     bool createScalarFieldsForExtraBytes(ccPointCloud &pointCloud);
@@ -83,10 +125,12 @@ class LasScalarFieldLoader
     /// The loaded values are stored into the member variable `rawValues`
     void parseRawValues(const LasExtraScalarField &extraField, uint8_t *dataStart);
 
-    template <typename T> void handleOptionsFor(const LasExtraScalarField &extraField, T values[3]);
+    template <typename T>
+    void handleOptionsFor(const LasExtraScalarField &extraField, unsigned int pointIndex, T values[3]);
 
   private:
     unsigned char colorCompShift{0};
+    bool colorCompShiftIsKnown{false};
     std::vector<LasScalarField> m_standardFields{};
     std::vector<LasExtraScalarField> m_extraScalarFields{};
 
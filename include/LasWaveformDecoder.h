@@ -0,0 +1,58 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#ifndef LASWAVEFORMDECODER_H
+#define LASWAVEFORMDECODER_H
+
+#include <ccWaveform.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class ccPointCloud;
+
+/// Decodes the samples of many waveforms of a cloud in one call.
+///
+/// The samples are converted to their real value (`digitizerOffset + digitizerGain * rawSample`)
+/// and stored in a contiguous row major matrix, with one row per waveform.
+/// Rows are as long as the longest waveform, and shorter waveforms
+/// (or points without a waveform) are padded with zeros.
+struct LasWaveformDecoder
+{
+    explicit LasWaveformDecoder(const ccPointCloud &pointCloud);
+
+    /// Returns the number of samples of the longest waveform of the points,
+    /// that is the number of columns of the decoded matrix.
+    uint32_t maxNumberOfSamples(const std::vector<unsigned int> &pointIndices) const;
+
+    /// Decodes the waveforms of the points into `samples`, which is resized to
+    /// `pointIndices.size() * numSamples`.
+    ///
+    /// Returns the number of samples per row (see `maxNumberOfSamples`).
+    uint32_t decode(const std::vector<unsigned int> &pointIndices, std::vector<float> &samples) const;
+
+  private:
+    /// Decodes the waveform of one point into a row of `numSamples` values.
+    void decodeWaveform(unsigned int pointIndex, uint32_t numSamples, float *row) const;
+
+  private:
+    const ccPointCloud &m_pointCloud;
+    /// Descriptor of each index, nullptr if the cloud has none for the index
+    std::array<const WaveformDescriptor *, 256> m_descriptors{};
+};
+
+#endif // LASWAVEFORMDECODER_H
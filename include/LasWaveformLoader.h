@@ -17,6 +17,7 @@
 #ifndef LASWAVEFORMLOADER_H
 #define LASWAVEFORMLOADER_H
 
+#include <QFile>
 #include <QFileInfo>
 #include <QString>
 
@@ -24,19 +25,55 @@
 
 #include <laszip/laszip_api.h>
 
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/// Loads the waveforms of the points.
+///
+/// While points are loaded only their wave packet description is stored.
+/// Once all the points are loaded, `transferDataTo` reads the data packets that the loaded points
+/// reference (and only these) from the LAS file or the external .wdp file
+/// into the clouds' FWF data container.
+///
+/// CloudCompare only knows about that in-memory container, so the referenced waveform data
+/// has to fit in memory: only loading a window or a subsample of the points uses less of it.
+///
+/// Sizes and offsets are 64 bits, as waveform data commonly exceeds 4 GB.
 struct LasWaveformLoader
 {
 
-    LasWaveformLoader(const laszip_header_struct &laszipHeader,
-                      const QString &lasFilename,
-                      ccPointCloud &pointCloud);
+    LasWaveformLoader(const laszip_header_struct &laszipHeader, const QString &lasFilename);
+
+    /// Allocates the waveforms of the point cloud so that `loadWaveform` can be called for its points.
+    bool prepare(ccPointCloud &pointCloud) const;
+
+    void loadWaveform(ccPointCloud &pointCloud,
+                      unsigned int pointIndex,
+                      const laszip_point &currentPoint) const;
 
-    void loadWaveform(ccPointCloud &pointCloud, const laszip_point &currentPoint) const;
+    /// Reads the data packets referenced by the waveforms of the point clouds
+    /// into a data container shared by all of them, and updates the waveforms offsets.
+    ///
+    /// The waveform data source is closed.
+    bool transferDataTo(const std::vector<ccPointCloud *> &pointClouds);
 
-    unsigned int fwfDataCount{0};
-    unsigned int fwfDataOffset{0};
+    uint64_t fwfDataCount{0};
+    uint64_t fwfDataOffset{0};
     bool isPointFormatExtended{false};
     ccPointCloud::FWFDescriptorSet descriptors;
+
+  private:
+    /// Reads `count` bytes of waveform data starting at `offset` by chunks.
+    bool readData(uint64_t offset, uint64_t count, uint8_t *dest);
+
+  private:
+    std::unique_ptr<QFile> m_fwfDataSource;
+    /// Position of the waveform data packets in the file
+    qint64 m_fwfDataStart{0};
+    /// Whether a descriptor exists for the index
+    std::array<bool, 256> m_isDescriptorValid{};
 };
 
 #endif // LASWAVEFORMLOADER_H
@@ -17,23 +17,27 @@
 #ifndef CLOUDCOMPAREPROJECTS_LASWAVEFORMSAVER_H
 #define CLOUDCOMPAREPROJECTS_LASWAVEFORMSAVER_H
 
-#include <QByteArray>
-#include <QDataStream>
-
 #include <laszip/laszip_api.h>
 
+#include <cstddef>
+
 class ccPointCloud;
+class WaveformDataRanges;
 
+/// Writes the wave packet of the points.
+///
+/// Only the waveform data referenced by the saved points is written,
+/// so the offsets of the waveforms are the ones they have in the compacted data.
 struct LasWaveformSaver
 {
 
-    LasWaveformSaver(const ccPointCloud &pointCloud) noexcept;
+    LasWaveformSaver(const ccPointCloud &pointCloud, const WaveformDataRanges &dataRanges) noexcept;
 
     void handlePoint(size_t index, laszip_point &point);
 
   private:
-    QByteArray m_array;
     const ccPointCloud &m_pointCloud;
+    const WaveformDataRanges &m_dataRanges;
 };
 
 #endif // CLOUDCOMPAREPROJECTS_LASWAVEFORMSAVER_H
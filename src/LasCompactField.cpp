@@ -0,0 +1,284 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasCompactField.h"
+
+#include <ccScalarField.h>
+
+#include <algorithm>
+#include <cstring>
+
+bool LasCompactField::IsSupported(LasScalarField::Id id)
+{
+    // These are not integers
+    return id != LasScalarField::GpsTime && id != LasScalarField::ExtendedScanAngle;
+}
+
+double LasCompactField::BytesPerValue(LasScalarField::Id id)
+{
+    return static_cast<double>(DataSize(StorageFor(id), 8)) / 8.0;
+}
+
+LasCompactField::LasCompactField(LasScalarField::Id id, unsigned int numPoints)
+    : m_id(id), m_storage(StorageFor(id)), m_size(numPoints)
+{
+    Q_ASSERT(IsSupported(id));
+}
+
+LasCompactField::Storage LasCompactField::StorageFor(LasScalarField::Id id)
+{
+    const LasScalarField::Range range = LasScalarField::ValueRange(id);
+    if (range.min < 0)
+    {
+        return Storage::Int8;
+    }
+    if (range.max <= 1)
+    {
+        return Storage::Bit;
+    }
+    if (range.max > std::numeric_limits<uint8_t>::max())
+    {
+        return Storage::UInt16;
+    }
+    return Storage::UInt8;
+}
+
+size_t LasCompactField::DataSize(Storage storage, unsigned int numPoints)
+{
+    switch (storage)
+    {
+    case Storage::Bit:
+        return (static_cast<size_t>(numPoints) + 7) / 8;
+    case Storage::Int8:
+    case Storage::UInt8:
+        return numPoints;
+    case Storage::UInt16:
+        return 2 * static_cast<size_t>(numPoints);
+    }
+    return 0;
+}
+
+const char *LasCompactField::name() const
+{
+    return LasScalarField(m_id).name();
+}
+
+size_t LasCompactField::memoryUsage() const
+{
+    return m_sparseValues.capacity() * sizeof(SparseValue) + m_data.capacity();
+}
+
+void LasCompactField::setValue(unsigned int index, int32_t value)
+{
+    Q_ASSERT(index < m_size);
+    if (m_storage == Storage::Bit)
+    {
+        // Flags may be given as a masked value (e.g. the overlap flag), any non zero value sets the bit
+        value = value != 0 ? 1 : 0;
+    }
+
+    switch (m_layout)
+    {
+    case Layout::Constant:
+        if (index == 0)
+        {
+            m_commonValue = value;
+            return;
+        }
+        if (value == m_commonValue)
+        {
+            return;
+        }
+        m_layout = Layout::Sparse;
+        break;
+    case Layout::Sparse:
+        Q_ASSERT(m_sparseValues.empty() || m_sparseValues.back().index < index);
+        if (value == m_commonValue)
+        {
+            return;
+        }
+        break;
+    case Layout::Dense:
+        setDenseValue(index, value);
+        return;
+    }
+
+    m_sparseValues.push_back({index, value});
+    if (m_sparseValues.size() * sizeof(SparseValue) > DataSize(m_storage, m_size) / 2)
+    {
+        densify();
+    }
+}
+
+ScalarType LasCompactField::getValue(unsigned int index) const
+{
+    Q_ASSERT(index < m_size);
+    switch (m_layout)
+    {
+    case Layout::Constant:
+        break;
+    case Layout::Sparse:
+    {
+        auto it = std::lower_bound(m_sparseValues.begin(),
+                                   m_sparseValues.end(),
+                                   index,
+                                   [](const SparseValue &sparseValue, unsigned int index)
+                                   { return sparseValue.index < index; });
+        if (it != m_sparseValues.end() && it->index == index)
+        {
+            return static_cast<ScalarType>(it->value);
+        }
+        break;
+    }
+    case Layout::Dense:
+        return getDenseValue(index);
+    }
+    return static_cast<ScalarType>(m_commonValue);
+}
+
+void LasCompactField::setDenseValue(unsigned int index, int32_t value)
+{
+    switch (m_storage)
+    {
+    case Storage::Bit:
+    {
+        const auto mask = static_cast<uint8_t>(1 << (index % 8));
+        if (value != 0)
+        {
+            m_data[index / 8] |= mask;
+        }
+        else
+        {
+            m_data[index / 8] &= ~mask;
+        }
+        break;
+    }
+    case Storage::Int8:
+        m_data[index] = static_cast<uint8_t>(static_cast<int8_t>(value));
+        break;
+    case Storage::UInt8:
+        m_data[index] = static_cast<uint8_t>(value);
+        break;
+    case Storage::UInt16:
+    {
+        const auto value16 = static_cast<uint16_t>(value);
+        std::memcpy(&m_data[2 * static_cast<size_t>(index)], &value16, sizeof(uint16_t));
+        break;
+    }
+    }
+}
+
+ScalarType LasCompactField::getDenseValue(unsigned int index) const
+{
+    switch (m_storage)
+    {
+    case Storage::Bit:
+        return static_cast<ScalarType>((m_data[index / 8] >> (index % 8)) & 1);
+    case Storage::Int8:
+        return static_cast<ScalarType>(static_cast<int8_t>(m_data[index]));
+    case Storage::UInt8:
+        return static_cast<ScalarType>(m_data[index]);
+    case Storage::UInt16:
+    {
+        uint16_t value16;
+        std::memcpy(&value16, &m_data[2 * static_cast<size_t>(index)], sizeof(uint16_t));
+        return static_cast<ScalarType>(value16);
+    }
+    }
+    return 0;
+}
+
+void LasCompactField::densify()
+{
+    m_data.resize(DataSize(m_storage, m_size));
+    if (m_storage == Storage::Bit)
+    {
+        std::fill(m_data.begin(), m_data.end(), m_commonValue != 0 ? 0xFF : 0x00);
+    }
+    else
+    {
+        for (unsigned int i{0}; i < m_size; ++i)
+        {
+            setDenseValue(i, m_commonValue);
+        }
+    }
+
+    for (const SparseValue &sparseValue : m_sparseValues)
+    {
+        setDenseValue(sparseValue.index, sparseValue.value);
+    }
+    m_sparseValues = std::vector<SparseValue>();
+    m_layout = Layout::Dense;
+}
+
+void LasCompactField::resize(unsigned int numPoints)
+{
+    if (numPoints >= m_size)
+    {
+        return;
+    }
+    m_size = numPoints;
+    switch (m_layout)
+    {
+    case Layout::Constant:
+        break;
+    case Layout::Sparse:
+    {
+        auto firstRemoved = std::lower_bound(m_sparseValues.begin(),
+                                             m_sparseValues.end(),
+                                             numPoints,
+                                             [](const SparseValue &sparseValue, unsigned int index)
+                                             { return sparseValue.index < index; });
+        m_sparseValues.erase(firstRemoved, m_sparseValues.end());
+        m_sparseValues.shrink_to_fit();
+        break;
+    }
+    case Layout::Dense:
+        m_data.resize(DataSize(m_storage, numPoints));
+        m_data.shrink_to_fit();
+        break;
+    }
+}
+
+ccScalarField *LasCompactField::toScalarField() const
+{
+    auto sf = new ccScalarField(name());
+    if (!sf->resizeSafe(m_size, true, static_cast<ScalarType>(m_commonValue)))
+    {
+        sf->release();
+        return nullptr;
+    }
+
+    switch (m_layout)
+    {
+    case Layout::Constant:
+        break;
+    case Layout::Sparse:
+        for (const SparseValue &sparseValue : m_sparseValues)
+        {
+            sf->setValue(sparseValue.index, static_cast<ScalarType>(sparseValue.value));
+        }
+        break;
+    case Layout::Dense:
+        for (unsigned int i{0}; i < m_size; ++i)
+        {
+            sf->setValue(i, getDenseValue(i));
+        }
+        break;
+    }
+    sf->computeMinAndMax();
+    return sf;
+}
@@ -24,6 +24,7 @@
 
 #include <QDataStream>
 
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include <vector>
@@ -109,6 +110,15 @@ uint16_t HeaderSize(unsigned int versionMinor)
     }
 }
 
+uint64_t PointCount(const laszip_header &header)
+{
+    if (header.version_minor == 4)
+    {
+        return header.extended_number_of_point_records;
+    }
+    return header.number_of_point_records;
+}
+
 constexpr const char *LasScalarField::NameFromId(LasScalarField::Id id)
 {
     switch (id)
@@ -323,6 +333,56 @@ LasScalarField::Range LasScalarField::ValueRange(LasScalarField::Id id)
     return Range::ForType<ScalarType>();
 }
 
+double LasScalarField::ValueFrom(LasScalarField::Id id, const laszip_point &point)
+{
+    switch (id)
+    {
+    case Intensity:
+        return point.intensity;
+    case ReturnNumber:
+        return point.return_number;
+    case NumberOfReturns:
+        return point.number_of_returns;
+    case ScanDirectionFlag:
+        return point.scan_direction_flag;
+    case EdgeOfFlightLine:
+        return point.edge_of_flight_line;
+    case Classification:
+        return point.classification;
+    case SyntheticFlag:
+        return point.synthetic_flag;
+    case KeypointFlag:
+        return point.keypoint_flag;
+    case WithheldFlag:
+        return point.withheld_flag;
+    case ScanAngleRank:
+        return point.scan_angle_rank;
+    case UserData:
+        return point.user_data;
+    case PointSourceId:
+        return point.point_source_ID;
+    case GpsTime:
+        return point.gps_time;
+    case ExtendedScanAngle:
+        return point.extended_scan_angle * SCAN_ANGLE_SCALE;
+    case ExtendedScannerChannel:
+        return point.extended_scanner_channel;
+    case OverlapFlag:
+        return point.extended_classification_flags & 8;
+    case ExtendedClassification:
+        return point.extended_classification;
+    case ExtendedReturnNumber:
+        return point.extended_return_number;
+    case ExtendedNumberOfReturns:
+        return point.extended_number_of_returns;
+    case NearInfrared:
+        return point.rgb[3];
+    }
+
+    Q_ASSERT_X(false, __FUNCTION__, "Unhandled las scalar field");
+    return 0.0;
+}
+
 LasScalarField::LasScalarField(LasScalarField::Id id, ccScalarField *sf)
     : id(id), sf(sf), range(LasScalarField::ValueRange(id))
 {
@@ -402,6 +462,71 @@ bool isExtraBytesVlr(const laszip_vlr_struct &vlr)
     return false;
 }
 
+uint32_t LayersToDecompress(const std::vector<LasScalarField> &fields,
+                            const std::vector<LasExtraScalarField> &extraFields)
+{
+    // X, Y, the returns and the scanner channel are in the base layer which is always decompressed
+    laszip_U32 layers = laszip_DECOMPRESS_SELECTIVE_Z | laszip_DECOMPRESS_SELECTIVE_RGB |
+                        laszip_DECOMPRESS_SELECTIVE_WAVEPACKET;
+
+    for (const LasScalarField &field : fields)
+    {
+        switch (field.id)
+        {
+        case LasScalarField::Intensity:
+            layers |= laszip_DECOMPRESS_SELECTIVE_INTENSITY;
+            break;
+        case LasScalarField::ScanDirectionFlag:
+        case LasScalarField::EdgeOfFlightLine:
+        case LasScalarField::SyntheticFlag:
+        case LasScalarField::KeypointFlag:
+        case LasScalarField::WithheldFlag:
+        case LasScalarField::OverlapFlag:
+            layers |= laszip_DECOMPRESS_SELECTIVE_FLAGS;
+            break;
+        case LasScalarField::Classification:
+        case LasScalarField::ExtendedClassification:
+            layers |= laszip_DECOMPRESS_SELECTIVE_CLASSIFICATION;
+            break;
+        case LasScalarField::ScanAngleRank:
+        case LasScalarField::ExtendedScanAngle:
+            layers |= laszip_DECOMPRESS_SELECTIVE_SCAN_ANGLE;
+            break;
+        case LasScalarField::UserData:
+            layers |= laszip_DECOMPRESS_SELECTIVE_USER_DATA;
+            break;
+        case LasScalarField::PointSourceId:
+            layers |= laszip_DECOMPRESS_SELECTIVE_POINT_SOURCE;
+            break;
+        case LasScalarField::GpsTime:
+            layers |= laszip_DECOMPRESS_SELECTIVE_GPS_TIME;
+            break;
+        case LasScalarField::NearInfrared:
+            layers |= laszip_DECOMPRESS_SELECTIVE_NIR;
+            break;
+        case LasScalarField::ReturnNumber:
+        case LasScalarField::NumberOfReturns:
+        case LasScalarField::ExtendedReturnNumber:
+        case LasScalarField::ExtendedNumberOfReturns:
+        case LasScalarField::ExtendedScannerChannel:
+            break;
+        }
+    }
+
+    // Each one of the first 16 extra bytes is its own layer
+    constexpr unsigned int NumSelectableExtraBytes = 16;
+    for (const LasExtraScalarField &extraField : extraFields)
+    {
+        const unsigned int end =
+            std::min(extraField.byteOffset + extraField.byteSize(), NumSelectableExtraBytes);
+        for (unsigned int i = extraField.byteOffset; i < end; ++i)
+        {
+            layers |= laszip_DECOMPRESS_SELECTIVE_BYTE0 << i;
+        }
+    }
+    return layers;
+}
+
 unsigned int SizeOfVlrs(const laszip_vlr_struct *vlrs, unsigned int numVlrs)
 {
     return std::accumulate(vlrs,
@@ -1090,4 +1215,60 @@ void cloneVlrInto(const laszip_vlr_struct &src, laszip_vlr_struct &dst)
     dst = src;
     dst.data = new laszip_U8[src.record_length_after_header];
     std::copy(src.data, src.data + src.record_length_after_header, dst.data);
-}
\ No newline at end of file
+}
+
+void WaveformDataRanges::add(uint64_t byteOffset, uint32_t byteCount)
+{
+    if (byteCount != 0)
+    {
+        m_ranges.push_back({byteOffset, byteOffset + byteCount, 0});
+    }
+}
+
+void WaveformDataRanges::merge()
+{
+    std::sort(m_ranges.begin(),
+              m_ranges.end(),
+              [](const Range &lhs, const Range &rhs) { return lhs.begin < rhs.begin; });
+
+    size_t numMerged{0};
+    uint64_t compactedSize{0};
+    for (const Range &range : m_ranges)
+    {
+        if (numMerged != 0 && range.begin <= m_ranges[numMerged - 1].end)
+        {
+            Range &last = m_ranges[numMerged - 1];
+            compactedSize += std::max(last.end, range.end) - last.end;
+            last.end = std::max(last.end, range.end);
+        }
+        else
+        {
+            m_ranges[numMerged] = {range.begin, range.end, compactedSize};
+            compactedSize += range.end - range.begin;
+            ++numMerged;
+        }
+    }
+    m_ranges.resize(numMerged);
+    m_ranges.shrink_to_fit();
+}
+
+uint64_t WaveformDataRanges::compactedOffset(uint64_t byteOffset) const
+{
+    auto it = std::upper_bound(m_ranges.begin(),
+                               m_ranges.end(),
+                               byteOffset,
+                               [](uint64_t offset, const Range &range) { return offset < range.begin; });
+    Q_ASSERT(it != m_ranges.begin());
+    --it;
+    return it->compactedStart + (byteOffset - it->begin);
+}
+
+uint64_t WaveformDataRanges::compactedSize() const
+{
+    if (m_ranges.empty())
+    {
+        return 0;
+    }
+    const Range &last = m_ranges.back();
+    return last.compactedStart + (last.end - last.begin);
+}
@@ -16,7 +16,13 @@
 //##########################################################################
 
 #include "LasIOFilter.h"
+#include "LasCompactField.h"
+#include "LasMemoryEstimate.h"
 #include "LasOpenDialog.h"
+#include "LasPendingDataMenu.h"
+#include "LasPlaceholder.h"
+#include "LasPointRecords.h"
+#include "LasProgressiveLoader.h"
 #include "LasSaveDialog.h"
 #include "LasSavedInfo.h"
 #include "LasScalarFieldLoader.h"
@@ -29,6 +35,8 @@
 #include <ccProgressDialog.h>
 #include <ccScalarField.h>
 
+#include <QCoreApplication>
+#include <QDataStream>
 #include <QDate>
 #include <QElapsedTimer>
 #include <QFileInfo>
@@ -36,11 +44,19 @@
 #include <laszip/laszip_api.h>
 
 #include <ccColorScalesManager.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <new>
 #include <numeric>
+#include <thread>
 #include <utility>
 
 const char *LAS_METADATA_INFO_KEY = "LAS.savedInfo";
+const char *LAS_COMPACT_FIELDS_KEY = "LAS.compactFields";
+const char *LAS_DEFERRED_FIELDS_KEY = "LAS.deferredFields";
 
 static CCVector3d GetGlobalShift(FileIOFilter::LoadParameters &parameters,
                                  bool &preserveCoordinateShift,
@@ -74,217 +90,2410 @@ static CCVector3d GetGlobalShift(FileIOFilter::LoadParameters &parameters,
     return shift;
 }
 
+static void CloseLaszipReader(laszip_POINTER laszipReader)
+{
+    laszip_close_reader(laszipReader);
+    laszip_clean(laszipReader);
+    laszip_destroy(laszipReader);
+}
+
+/// Sets the display parameters (color scale, steps, etc) of the scalar fields
+/// that were loaded, and selects the scalar field to display.
+static void SetupLoadedScalarFields(ccPointCloud &pointCloud, const std::vector<LasScalarField> &fields)
+{
+    for (const LasScalarField &field : fields)
+    {
+        if (field.sf == nullptr)
+        {
+            // It may be null if all values were the same
+            continue;
+        }
+        field.sf->computeMinAndMax();
+        switch (field.id)
+        {
+        case LasScalarField::Intensity:
+            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::GREY));
+            field.sf->setSaturationStart(field.sf->getMin());
+            field.sf->setSaturationStop(field.sf->getMax());
+            field.sf->setMinDisplayed(field.sf->getMin());
+            field.sf->setMaxDisplayed(field.sf->getMax());
+        case LasScalarField::ReturnNumber:
+        case LasScalarField::NumberOfReturns:
+        case LasScalarField::ScanDirectionFlag:
+        case LasScalarField::EdgeOfFlightLine:
+        case LasScalarField::Classification:
+        case LasScalarField::SyntheticFlag:
+        case LasScalarField::KeypointFlag:
+        case LasScalarField::WithheldFlag:
+        case LasScalarField::ScanAngleRank:
+        case LasScalarField::UserData:
+        case LasScalarField::PointSourceId:
+        case LasScalarField::ExtendedScannerChannel:
+        case LasScalarField::OverlapFlag:
+        case LasScalarField::ExtendedClassification:
+        case LasScalarField::ExtendedReturnNumber:
+        case LasScalarField::ExtendedNumberOfReturns:
+        case LasScalarField::NearInfrared:
+        {
+            auto cMin = static_cast<int64_t>(field.sf->getMin());
+            auto cMax = static_cast<int64_t>(field.sf->getMax());
+            int64_t steps = std::min<int64_t>(cMax - cMin + 1, 256);
+            field.sf->setColorRampSteps(steps);
+            break;
+        }
+        case LasScalarField::GpsTime:
+            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::BGYR));
+            break;
+        case LasScalarField::ExtendedScanAngle:
+            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::BGYR));
+            break;
+        }
+    }
+
+    int idx = pointCloud.getScalarFieldIndexByName(LasNames::Intensity);
+    if (idx != -1)
+    {
+        pointCloud.setCurrentDisplayedScalarField(idx);
+    }
+    else if (pointCloud.getNumberOfScalarFields() > 0)
+    {
+        pointCloud.setCurrentDisplayedScalarField(0);
+    }
+    pointCloud.showColors(pointCloud.hasColors());
+    pointCloud.showSF(!pointCloud.hasColors() && pointCloud.hasDisplayedScalarField());
+}
+
+static void LogElapsedTime(const QElapsedTimer &timer)
+{
+    qint64 elapsed = timer.elapsed();
+    int32_t minutes = elapsed / (1000 * 60);
+    elapsed -= minutes * (1000 * 60);
+    int32_t seconds = elapsed / 1000;
+    elapsed -= seconds * 1000;
+    ccLog::Print(QString("[LAS] File loaded in %1m%2s%3ms").arg(minutes).arg(seconds).arg(elapsed));
+}
+
+/// Waits for the worker threads to finish.
+///
+/// While waiting, the progress dialog is updated with the number of points processed
+/// by the workers, and the user's cancel request is forwarded to them.
+static void WaitForWorkers(std::vector<std::thread> &threads,
+                           const std::atomic<size_t> &numFinishedThreads,
+                           const std::atomic<unsigned int> &numProcessed,
+                           std::atomic<bool> &cancelRequested,
+                           ccProgressDialog &progressDialog,
+                           CCCoreLib::NormalizedProgress &normProgress)
+{
+    unsigned int lastProgressUpdate{0};
+    while (numFinishedThreads < threads.size())
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        const unsigned int processed = numProcessed;
+        normProgress.steps(processed - lastProgressUpdate);
+        lastProgressUpdate = processed;
+        QCoreApplication::processEvents();
+        if (progressDialog.isCancelRequested())
+        {
+            cancelRequested = true;
+        }
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+/// Re-opens the reader so that laszip only decompresses the layers needed to load the fields.
+///
+/// laszip only accepts the selection before the file is opened, and the selection only
+/// matters for the layered compression of the LAS 1.4 point formats, so other files are left as is.
+/// The header and point pointers are updated as the previous ones are invalidated.
+static bool ReopenWithSelectiveDecompression(laszip_POINTER laszipReader,
+                                             const QString &fileName,
+                                             bool isCompressed,
+                                             const std::vector<LasScalarField> &fields,
+                                             const std::vector<LasExtraScalarField> &extraFields,
+                                             laszip_header *&laszipHeader,
+                                             laszip_point *&laszipPoint)
+{
+    if (!isCompressed || laszipHeader->point_data_format < 6)
+    {
+        return true;
+    }
+
+    const laszip_U32 layers = LayersToDecompress(fields, extraFields);
+    laszip_BOOL isStillCompressed{false};
+    return laszip_close_reader(laszipReader) == 0 && laszip_clean(laszipReader) == 0 &&
+           laszip_decompress_selective(laszipReader, layers) == 0 &&
+           laszip_open_reader(laszipReader, qPrintable(fileName), &isStillCompressed) == 0 &&
+           laszip_get_header_pointer(laszipReader, &laszipHeader) == 0 &&
+           laszip_get_point_pointer(laszipReader, &laszipPoint) == 0;
+}
+
+/// A file that is part of a merge.
+struct LasMergeSource
+{
+    QString fileName;
+    laszip_POINTER reader{nullptr};
+    laszip_header *header{nullptr};
+    laszip_point *point{nullptr};
+    unsigned int pointCount{0};
+    /// Index, in the merged cloud, of the first point of this file
+    unsigned int firstIndex{0};
+    std::vector<LasScalarField> standardFields;
+    std::vector<LasExtraScalarField> extraFields;
+    std::unique_ptr<LasScalarFieldLoader> loader;
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+};
+
+/// Decodes all the points of the source into its range of the merged cloud.
+///
+/// This is meant to run concurrently for different sources: all the scalar fields
+/// and the color table are created beforehand, and each source writes to its own range.
+static void DecodeMergeSource(LasMergeSource &source,
+                              ccPointCloud &pointCloud,
+                              const CCVector3d &shift,
+                              std::atomic<unsigned int> &numLoaded,
+                              const std::atomic<bool> &cancelRequested)
+{
+    const bool hasRGB = HasRGB(source.header->point_data_format);
+    for (unsigned int i{0}; i < source.pointCount; ++i)
+    {
+        if (cancelRequested)
+        {
+            source.error = CC_FERR_CANCELED_BY_USER;
+            return;
+        }
+
+        if (laszip_read_point(source.reader))
+        {
+            source.error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            return;
+        }
+
+        source.error = source.loader->loadPoint(
+            source.reader, *source.point, shift, hasRGB, pointCloud, source.firstIndex + i);
+        if (source.error != CC_FERR_NO_ERROR)
+        {
+            return;
+        }
+        ++numLoaded;
+    }
+}
+
+/// Loads all the files into a single point cloud.
+///
+/// The total number of points is known from the headers so that the cloud is allocated once,
+/// and the global shift is chosen from the union of the headers bounding boxes.
+/// Scalar fields are matched by name (so the same LAS field or extra bytes field in different
+/// files ends up in the same scalar field), and files are decoded concurrently.
+static CC_FILE_ERROR LoadMergedFiles(const QStringList &fileNames,
+                                     const LasOpenDialog &dialog,
+                                     ccHObject &container,
+                                     FileIOFilter::LoadParameters &parameters)
+{
+    std::vector<LasMergeSource> sources(fileNames.size());
+    const auto closeSources = [&sources]()
+    {
+        for (LasMergeSource &source : sources)
+        {
+            if (source.reader)
+            {
+                CloseLaszipReader(source.reader);
+                source.reader = nullptr;
+            }
+        }
+    };
+
+    uint64_t totalPointCount{0};
+    CCVector3d unionMin(std::numeric_limits<double>::max(),
+                        std::numeric_limits<double>::max(),
+                        std::numeric_limits<double>::max());
+    laszip_BOOL isCompressed{false};
+    laszip_CHAR *errorMsg{nullptr};
+    for (int i{0}; i < fileNames.size(); ++i)
+    {
+        LasMergeSource &source = sources[i];
+        source.fileName = fileNames[i];
+        if (laszip_create(&source.reader))
+        {
+            closeSources();
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+
+        if (laszip_open_reader(source.reader, qPrintable(source.fileName), &isCompressed) ||
+            laszip_get_header_pointer(source.reader, &source.header) ||
+            laszip_get_point_pointer(source.reader, &source.point))
+        {
+            laszip_get_error(source.reader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error with '%s': '%s'", qPrintable(source.fileName), errorMsg);
+            closeSources();
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+
+        if (HasWaveform(source.header->point_data_format))
+        {
+            ccLog::Warning("[LAS] Waveforms are not loaded when merging files ('%s')",
+                           qPrintable(source.fileName));
+        }
+
+        source.pointCount = static_cast<unsigned int>(PointCount(*source.header));
+        source.firstIndex = static_cast<unsigned int>(totalPointCount);
+        totalPointCount += PointCount(*source.header);
+
+        unionMin.x = std::min(unionMin.x, source.header->min_x);
+        unionMin.y = std::min(unionMin.y, source.header->min_y);
+        unionMin.z = std::min(unionMin.z, source.header->min_z);
+
+        source.standardFields = LasScalarFieldForPointFormat(source.header->point_data_format);
+        source.extraFields = LasExtraScalarField::ParseExtraScalarFields(*source.header);
+
+        const auto isStandardUnchecked = [&dialog](const LasScalarField &field)
+        { return dialog.isUnchecked(field.name()); };
+        const auto isExtraUnchecked = [&dialog](const LasExtraScalarField &field)
+        { return dialog.isUnchecked(field.name); };
+        source.standardFields.erase(
+            std::remove_if(source.standardFields.begin(), source.standardFields.end(), isStandardUnchecked),
+            source.standardFields.end());
+        source.extraFields.erase(
+            std::remove_if(source.extraFields.begin(), source.extraFields.end(), isExtraUnchecked),
+            source.extraFields.end());
+
+        if (!ReopenWithSelectiveDecompression(source.reader,
+                                              source.fileName,
+                                              isCompressed,
+                                              source.standardFields,
+                                              source.extraFields,
+                                              source.header,
+                                              source.point))
+        {
+            laszip_get_error(source.reader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error with '%s': '%s'", qPrintable(source.fileName), errorMsg);
+            closeSources();
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+    }
+
+    if (totalPointCount >= std::numeric_limits<unsigned int>::max())
+    {
+        ccLog::Error(QString("The merged cloud would have more than %1 points, which is not supported")
+                         .arg(totalPointCount));
+        closeSources();
+        return CC_FERR_NOT_IMPLEMENTED;
+    }
+
+    auto pointCloud =
+        std::make_unique<ccPointCloud>(QString("%1 (merged)").arg(QFileInfo(fileNames[0]).fileName()));
+    if (!pointCloud->resize(static_cast<unsigned int>(totalPointCount)))
+    {
+        closeSources();
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+
+    bool preserveGlobalShift{true};
+    CCVector3d shift = GetGlobalShift(parameters, preserveGlobalShift, unionMin, unionMin);
+    if (preserveGlobalShift)
+    {
+        pointCloud->setGlobalShift(shift);
+    }
+    if (shift.norm2() != 0.0)
+    {
+        ccLog::Warning(
+            "[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)", shift.x, shift.y, shift.z);
+    }
+
+    // Create the union of the standard fields, so that no scalar field
+    // has to be created lazily by the loaders while decoding concurrently.
+    std::vector<LasScalarField> mergedFields;
+    for (LasMergeSource &source : sources)
+    {
+        for (LasScalarField &field : source.standardFields)
+        {
+            auto it = std::find_if(mergedFields.begin(),
+                                   mergedFields.end(),
+                                   [&field](const LasScalarField &other)
+                                   { return strcmp(other.name(), field.name()) == 0; });
+            if (it != mergedFields.end())
+            {
+                field.sf = it->sf;
+                continue;
+            }
+
+            auto sf = new ccScalarField(field.name());
+            if (!sf->resizeSafe(pointCloud->size(), true, 0))
+            {
+                sf->release();
+                closeSources();
+                return CC_FERR_NOT_ENOUGH_MEMORY;
+            }
+            pointCloud->addScalarField(sf);
+            field.sf = sf;
+            mergedFields.push_back(field);
+
+            if (field.id == LasScalarField::GpsTime)
+            {
+                // Use the first Gps Time of the file as the shift
+                if (laszip_read_point(source.reader) == 0)
+                {
+                    sf->setGlobalShift(source.point->gps_time);
+                }
+                laszip_seek_point(source.reader, 0);
+            }
+        }
+    }
+
+    // Extra bytes fields are matched by name, the first loader that has one
+    // creates the scalar fields, the following ones re-use them.
+    std::vector<LasExtraScalarField> mergedExtraFields;
+    for (LasMergeSource &source : sources)
+    {
+        const auto mergedFieldNamed = [&mergedExtraFields](const LasExtraScalarField &extraField)
+        {
+            return std::find_if(mergedExtraFields.begin(),
+                                mergedExtraFields.end(),
+                                [&extraField](const LasExtraScalarField &other)
+                                { return strcmp(other.name, extraField.name) == 0; });
+        };
+
+        // A field with the same name but a different number of elements cannot share the scalar fields
+        const auto hasOtherNumElements = [&](const LasExtraScalarField &extraField)
+        {
+            auto it = mergedFieldNamed(extraField);
+            if (it == mergedExtraFields.end() || it->numElements() == extraField.numElements())
+            {
+                return false;
+            }
+            ccLog::Warning(QString("[LAS] '%1' of '%2' has %3 elements instead of %4, it is not loaded")
+                               .arg(QString(extraField.name), source.fileName)
+                               .arg(extraField.numElements())
+                               .arg(it->numElements()));
+            return true;
+        };
+        source.extraFields.erase(
+            std::remove_if(source.extraFields.begin(), source.extraFields.end(), hasOtherNumElements),
+            source.extraFields.end());
+
+        for (LasExtraScalarField &extraField : source.extraFields)
+        {
+            auto it = mergedFieldNamed(extraField);
+            if (it != mergedExtraFields.end())
+            {
+                std::copy(it->scalarFields, it->scalarFields + 3, extraField.scalarFields);
+                extraField.ccName = it->ccName;
+            }
+        }
+
+        source.loader = std::make_unique<LasScalarFieldLoader>(
+            source.standardFields, source.extraFields, *pointCloud);
+
+        for (const LasExtraScalarField &extraField : source.loader->extraFields())
+        {
+            if (std::none_of(mergedExtraFields.begin(),
+                             mergedExtraFields.end(),
+                             [&extraField](const LasExtraScalarField &other)
+                             { return strcmp(other.name, extraField.name) == 0; }))
+            {
+                mergedExtraFields.push_back(extraField);
+            }
+        }
+    }
+
+    if (std::any_of(sources.begin(),
+                    sources.end(),
+                    [](const LasMergeSource &source) { return HasRGB(source.header->point_data_format); }))
+    {
+        if (!pointCloud->resizeTheRGBTable(false))
+        {
+            closeSources();
+            return CC_FERR_NOT_ENOUGH_MEMORY;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Loading LAS points");
+    progressDialog.setInfo(QString("Loading points of %1 files").arg(sources.size()));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCloud->size());
+    progressDialog.start();
+
+    std::atomic<unsigned int> numLoaded{0};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<size_t> nextSource{0};
+    std::atomic<size_t> numFinishedThreads{0};
+    const auto worker = [&]()
+    {
+        for (size_t i = nextSource++; i < sources.size(); i = nextSource++)
+        {
+            DecodeMergeSource(sources[i], *pointCloud, shift, numLoaded, cancelRequested);
+            if (sources[i].error != CC_FERR_NO_ERROR)
+            {
+                // No need to decode the other files
+                cancelRequested = true;
+            }
+        }
+        ++numFinishedThreads;
+    };
+
+    const size_t numThreads =
+        std::min<size_t>(sources.size(), std::max<unsigned int>(1, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t i{0}; i < numThreads; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+
+    WaitForWorkers(threads, numFinishedThreads, numLoaded, cancelRequested, progressDialog, normProgress);
+    if (pointCloud->hasColors())
+    {
+        // The loaders do not notify the cloud as they write colors concurrently
+        pointCloud->colorsHaveChanged();
+    }
+
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    for (const LasMergeSource &source : sources)
+    {
+        if (source.error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+        {
+            laszip_get_error(source.reader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error with '%s': '%s'", qPrintable(source.fileName), errorMsg);
+        }
+        if (source.error != CC_FERR_NO_ERROR &&
+            (error == CC_FERR_NO_ERROR || error == CC_FERR_CANCELED_BY_USER))
+        {
+            error = source.error;
+        }
+    }
+
+    LasSavedInfo info(*sources[0].header);
+    closeSources();
+
+    if (error != CC_FERR_NO_ERROR)
+    {
+        // Ranges of the files that were not fully decoded would be left with garbage
+        return error;
+    }
+
+    // Same as the regular loading, do not keep fields where all values are the default one
+    for (LasScalarField &field : mergedFields)
+    {
+        field.sf->computeMinAndMax();
+        if (field.sf->getMin() == 0 && field.sf->getMax() == 0)
+        {
+            pointCloud->deleteScalarField(pointCloud->getScalarFieldIndexByName(field.name()));
+            field.sf = nullptr;
+        }
+    }
+    SetupLoadedScalarFields(*pointCloud, mergedFields);
+
+    for (LasExtraScalarField &extraField : mergedExtraFields)
+    {
+        extraField.resetScalarFieldsPointers();
+    }
+
+    info.extraScalarFields = mergedExtraFields;
+    pointCloud->setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(info));
+
+    container.addChild(pointCloud.release());
+    LogElapsedTime(timer);
+    return CC_FERR_NO_ERROR;
+}
+
+/// A cloud created when splitting a file by the values of a field.
+struct LasSplitTarget
+{
+    std::unique_ptr<ccPointCloud> cloud;
+    std::unique_ptr<LasScalarFieldLoader> loader;
+    /// Number of points loaded so far, also the index where the next one goes.
+    unsigned int numPoints{0};
+};
+
+/// Resizes the waveforms of the cloud, which `ccPointCloud::resize` leaves as is
+/// until the cloud has its waveform data.
+static bool ResizeWaveforms(ccPointCloud &pointCloud, unsigned int size)
+{
+    try
+    {
+        pointCloud.waveforms().resize(size);
+    }
+    catch (const std::bad_alloc &)
+    {
+        return false;
+    }
+    return true;
+}
+
+/// Loads the points of the file into one cloud per distinct value of the `splitId` field.
+///
+/// The points are decoded in a single pass: a cloud is created the first time its value is met,
+/// and grows geometrically (with its fields, colors and waveforms) as points are added to it.
+static CC_FILE_ERROR LoadSplitFile(const QString &fileName,
+                                   laszip_POINTER laszipReader,
+                                   const laszip_header &laszipHeader,
+                                   const laszip_point &laszipPoint,
+                                   unsigned int pointCount,
+                                   LasScalarField::Id splitId,
+                                   const std::vector<LasScalarField> &scalarFields,
+                                   const std::vector<LasExtraScalarField> &extraScalarFields,
+                                   ccHObject &container,
+                                   FileIOFilter::LoadParameters &parameters)
+{
+    // All the splittable fields are stored on at most 16 bits
+    constexpr size_t MaxNumKeys = std::numeric_limits<uint16_t>::max() + 1;
+    constexpr unsigned int MinCloudCapacity = 4096;
+    const auto keyOf = [splitId](const laszip_point &point)
+    { return static_cast<size_t>(LasScalarField::ValueFrom(splitId, point)) % MaxNumKeys; };
+    const QString splitName = LasScalarField(splitId).name();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    // The first point is read to compute the global shift, the pass then starts over from it
+    laszip_F64 laszipCoordinates[3];
+    if (laszip_read_point(laszipReader) || laszip_get_coordinates(laszipReader, laszipCoordinates) ||
+        laszip_seek_point(laszipReader, 0))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+    const CCVector3d firstPoint(laszipCoordinates[0], laszipCoordinates[1], laszipCoordinates[2]);
+
+    bool preserveGlobalShift{true};
+    CCVector3d lasMins(laszipHeader.min_x, laszipHeader.min_y, laszipHeader.min_z);
+    CCVector3d shift = GetGlobalShift(parameters, preserveGlobalShift, lasMins, firstPoint);
+    if (shift.norm2() != 0.0)
+    {
+        ccLog::Warning(
+            "[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)", shift.x, shift.y, shift.z);
+    }
+
+    const QString baseName = QFileInfo(fileName).fileName();
+    std::vector<LasSplitTarget> targets;
+    constexpr size_t NoTarget = std::numeric_limits<size_t>::max();
+    std::vector<size_t> targetOfKey(MaxNumKeys, NoTarget);
+
+    std::unique_ptr<LasWaveformLoader> waveformLoader{nullptr};
+    if (HasWaveform(laszipHeader.point_data_format))
+    {
+        waveformLoader = std::make_unique<LasWaveformLoader>(laszipHeader, fileName);
+    }
+
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Loading LAS points");
+    progressDialog.setInfo(QString("Splitting points by %1").arg(splitName));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCount);
+    unsigned int numStepsForUpdate = 1 * pointCount / 100;
+    unsigned int lastProgressUpdate = 0;
+    progressDialog.start();
+
+    const bool hasRGB = HasRGB(laszipHeader.point_data_format);
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    for (unsigned int i{0}; i < pointCount; ++i)
+    {
+        if (progressDialog.isCancelRequested())
+        {
+            error = CC_FERR_CANCELED_BY_USER;
+            break;
+        }
+
+        if (laszip_read_point(laszipReader))
+        {
+            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            break;
+        }
+
+        const size_t key = keyOf(laszipPoint);
+        if (targetOfKey[key] == NoTarget)
+        {
+            LasSplitTarget target;
+            const QString cloudName = QString("%1 - %2 %3").arg(baseName, splitName).arg(key);
+            target.cloud = std::make_unique<ccPointCloud>(cloudName);
+            target.cloud->setGlobalShift(shift);
+            if (!target.cloud->resize(std::min(MinCloudCapacity, pointCount - i)))
+            {
+                error = CC_FERR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+            target.loader =
+                std::make_unique<LasScalarFieldLoader>(scalarFields, extraScalarFields, *target.cloud);
+            if (waveformLoader && !waveformLoader->prepare(*target.cloud))
+            {
+                for (LasSplitTarget &preparedTarget : targets)
+                {
+                    preparedTarget.cloud->waveforms().clear();
+                }
+                waveformLoader.reset();
+            }
+            targetOfKey[key] = targets.size();
+            targets.push_back(std::move(target));
+        }
+
+        LasSplitTarget &target = targets[targetOfKey[key]];
+        ccPointCloud &pointCloud = *target.cloud;
+        const unsigned int pointIndex = target.numPoints;
+        if (pointIndex == pointCloud.size())
+        {
+            // The scalar fields and the colors of the cloud are resized with it, not its waveforms
+            // as the cloud has no waveform data yet
+            const unsigned int newSize = pointIndex + std::min(pointIndex, pointCount - i);
+            if (!pointCloud.resize(newSize) || (waveformLoader && !ResizeWaveforms(pointCloud, newSize)))
+            {
+                error = CC_FERR_NOT_ENOUGH_MEMORY;
+                break;
+            }
+        }
+
+        error = target.loader->loadPoint(laszipReader, laszipPoint, shift, hasRGB, pointCloud, pointIndex);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            break;
+        }
+
+        if (waveformLoader)
+        {
+            waveformLoader->loadWaveform(pointCloud, pointIndex, laszipPoint);
+        }
+        ++target.numPoints;
+
+        if ((i - lastProgressUpdate) == numStepsForUpdate)
+        {
+            normProgress.steps(i - lastProgressUpdate);
+            lastProgressUpdate += (i - lastProgressUpdate);
+        }
+    }
+
+    std::vector<LasExtraScalarField> savedExtraFields = extraScalarFields;
+    for (LasExtraScalarField &extraField : savedExtraFields)
+    {
+        extraField.resetScalarFieldsPointers();
+    }
+    LasSavedInfo info(laszipHeader);
+    info.extraScalarFields = savedExtraFields;
+
+    for (LasSplitTarget &target : targets)
+    {
+        if (target.numPoints < target.cloud->size())
+        {
+            // Clouds are allocated ahead of their points, or loading was interrupted
+            target.cloud->resize(target.numPoints);
+            target.cloud->shrinkToFit();
+            if (waveformLoader && ResizeWaveforms(*target.cloud, target.numPoints))
+            {
+                target.cloud->waveforms().shrink_to_fit();
+            }
+        }
+    }
+
+    if (waveformLoader)
+    {
+        // The waveform data is shared by all the clouds
+        std::vector<ccPointCloud *> clouds;
+        for (const LasSplitTarget &target : targets)
+        {
+            clouds.push_back(target.cloud.get());
+        }
+        waveformLoader->transferDataTo(clouds);
+    }
+
+    auto group = new ccHObject(baseName);
+    for (LasSplitTarget &target : targets)
+    {
+        if (target.numPoints == 0)
+        {
+            continue;
+        }
+
+        SetupLoadedScalarFields(*target.cloud, target.loader->standardFields());
+        target.cloud->setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(info));
+        group->addChild(target.cloud.release());
+    }
+    container.addChild(group);
+
+    LogElapsedTime(timer);
+    return error;
+}
+
 laszip_header
 InitLaszipHeader(const LasSaveDialog &saveDialog, LasSavedInfo &savedInfo, ccPointCloud &pointCloud)
 {
-    laszip_header laszipHeader{};
+    laszip_header laszipHeader{};
+
+    QDate currentDate = QDate::currentDate();
+    laszipHeader.file_creation_year = currentDate.year();
+    laszipHeader.file_creation_day = currentDate.dayOfYear();
+
+    laszipHeader.version_major = 1;
+    laszipHeader.version_minor = saveDialog.selectedVersionMinor();
+    laszipHeader.point_data_format = saveDialog.selectedPointFormat();
+
+    // TODO global encoding wkt and other
+    if (HasWaveform(laszipHeader.point_data_format) && pointCloud.hasFWF())
+    {
+        if (saveDialog.shouldSaveWaveformInternally())
+        {
+            // The EVLR is appended once laszip is done writing the points
+            laszipHeader.global_encoding |= 0b0000'0010;
+        }
+        else
+        {
+            laszipHeader.global_encoding |= 0b0000'0100;
+        }
+    }
+
+    laszipHeader.header_size = HeaderSize(laszipHeader.version_minor);
+    laszipHeader.offset_to_point_data = laszipHeader.header_size;
+    laszipHeader.point_data_record_length = PointFormatSize(laszipHeader.point_data_format);
+
+    CCVector3d lasScale = saveDialog.chosenScale();
+    laszipHeader.x_scale_factor = lasScale.x;
+    laszipHeader.y_scale_factor = lasScale.y;
+    laszipHeader.z_scale_factor = lasScale.z;
+
+    laszipHeader.file_source_ID = savedInfo.fileSourceId;
+    laszipHeader.project_ID_GUID_data_1 = savedInfo.guidData1;
+    laszipHeader.project_ID_GUID_data_2 = savedInfo.guidData2;
+    laszipHeader.project_ID_GUID_data_3 = savedInfo.guidData3;
+    strncpy(laszipHeader.project_ID_GUID_data_4, savedInfo.guidData4, 8);
+    strncpy(laszipHeader.system_identifier, savedInfo.systemIdentifier, 32);
+    strncpy(laszipHeader.generating_software, "CloudCompare", 32);
+
+    if (savedInfo.extraScalarFields.empty())
+    {
+        // 'steal' saved vlrs
+        laszipHeader.number_of_variable_length_records = savedInfo.numVlrs;
+        laszipHeader.vlrs = savedInfo.vlrs;
+        savedInfo.numVlrs = 0;
+        savedInfo.vlrs = nullptr;
+    }
+    else
+    {
+        laszipHeader.number_of_variable_length_records = savedInfo.numVlrs + 1;
+        laszipHeader.vlrs = new laszip_vlr_struct[laszipHeader.number_of_variable_length_records];
+        for (laszip_U32 i{0}; i < savedInfo.numVlrs; i++)
+        {
+            cloneVlrInto(savedInfo.vlrs[i], laszipHeader.vlrs[i]);
+        }
+
+        LasExtraScalarField::InitExtraBytesVlr(
+            laszipHeader.vlrs[laszipHeader.number_of_variable_length_records - 1],
+            savedInfo.extraScalarFields);
+    }
+
+    laszipHeader.offset_to_point_data +=
+        SizeOfVlrs(laszipHeader.vlrs, laszipHeader.number_of_variable_length_records);
+
+    if (pointCloud.isShifted())
+    {
+        laszipHeader.x_offset = -pointCloud.getGlobalShift().x;
+        laszipHeader.y_offset = -pointCloud.getGlobalShift().y;
+        laszipHeader.z_offset = -pointCloud.getGlobalShift().z;
+    }
+    else
+    {
+        CCVector3 bbMax;
+        CCVector3 bbMin;
+        pointCloud.getBoundingBox(bbMin, bbMax);
+        laszipHeader.x_offset = bbMin.x;
+        laszipHeader.y_offset = bbMin.y;
+        laszipHeader.z_offset = bbMin.z;
+    }
+
+    LasExtraScalarField::MatchExtraBytesToScalarFields(savedInfo.extraScalarFields, pointCloud);
+    LasExtraScalarField::UpdateByteOffsets(savedInfo.extraScalarFields);
+    unsigned int totalExtraByteSize = LasExtraScalarField::TotalExtraBytesSize(savedInfo.extraScalarFields);
+    laszipHeader.point_data_record_length += totalExtraByteSize;
+    return laszipHeader;
+}
+
+/// Points of a cloud to write in a LAS file, with how to write them.
+///
+/// Fields are bound to the scalar fields of this cloud, as multiple clouds
+/// can be written into the same file.
+struct LasWriteSource
+{
+    const ccPointCloud *cloud{nullptr};
+    /// Indices of the points to write, all the points of the cloud are written if empty.
+    std::vector<unsigned int> indices;
+    std::vector<LasScalarField> fieldsToSave;
+    std::vector<LasExtraScalarField> extraFields;
+    bool saveRGB{false};
+    bool saveWaveform{false};
+
+    unsigned int numPoints() const
+    {
+        return indices.empty() ? cloud->size() : static_cast<unsigned int>(indices.size());
+    }
+};
+
+/// Returns the ranges of waveform data referenced by the points of the sources.
+static WaveformDataRanges CollectWaveformDataRanges(const std::vector<LasWriteSource> &sources)
+{
+    WaveformDataRanges dataRanges;
+    for (const LasWriteSource &source : sources)
+    {
+        if (!source.saveWaveform)
+        {
+            continue;
+        }
+        const std::vector<ccWaveform> &waveforms = source.cloud->waveforms();
+        for (unsigned int j{0}; j < source.numPoints(); ++j)
+        {
+            const ccWaveform &w = waveforms[source.indices.empty() ? j : source.indices[j]];
+            dataRanges.add(w.dataOffset(), w.byteCount());
+        }
+    }
+    dataRanges.merge();
+    return dataRanges;
+}
+
+/// Writes the points of the sources, one after the other, into a new LAS/LAZ file.
+///
+/// `waveformDataRanges` are the ranges of the waveform data that will be written
+/// with the file, it is only needed if sources save waveforms.
+///
+/// When compressing point formats >= 6, laszip uses its native LAS 1.4 extension (layered chunks)
+/// unless `layeredCompression` is false, in which case the compatibility mode is requested, to write
+/// points that older LAZ readers can decompress.
+///
+/// This does not touch any widget so that multiple files can be written concurrently.
+static CC_FILE_ERROR WriteLasFile(const QString &filename,
+                                  const laszip_header &laszipHeader,
+                                  const std::vector<LasWriteSource> &sources,
+                                  const WaveformDataRanges *waveformDataRanges,
+                                  bool layeredCompression,
+                                  std::atomic<unsigned int> &numWritten,
+                                  const std::atomic<bool> &cancelRequested)
+{
+    laszip_POINTER laszipWriter{nullptr};
+    laszip_CHAR *errorMsg{nullptr};
+
+    if (laszip_create(&laszipWriter))
+    {
+        ccLog::Warning("[LAS] laszip failed to create the writer");
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    const bool isCompressed = filename.endsWith("laz");
+    const bool compatibilityMode = isCompressed && laszipHeader.point_data_format >= 6 && !layeredCompression;
+    if ((compatibilityMode && laszip_request_compatibility_mode(laszipWriter, true)) ||
+        laszip_set_header(laszipWriter, &laszipHeader) ||
+        laszip_open_writer(laszipWriter, qPrintable(filename), isCompressed))
+    {
+        laszip_get_error(laszipWriter, &errorMsg);
+        ccLog::Warning("[LAS] laszip error :'%s'", errorMsg);
+        laszip_destroy(laszipWriter);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    laszip_point laszipPoint{};
+    int totalExtraByteSize =
+        laszipHeader.point_data_record_length - PointFormatSize(laszipHeader.point_data_format);
+    laszip_U8 *extraBytes = totalExtraByteSize > 0 ? new laszip_U8[totalExtraByteSize] : nullptr;
+
+    constexpr unsigned int NumPointsPerProgressUpdate = 4096;
+    const CCVector3d lasOffset(laszipHeader.x_offset, laszipHeader.y_offset, laszipHeader.z_offset);
+
+    CC_FILE_ERROR error = CC_FERR_NO_ERROR;
+    for (const LasWriteSource &source : sources)
+    {
+        const ccPointCloud &pointCloud = *source.cloud;
+        LasScalarFieldSaver fieldSaver(source.fieldsToSave, source.extraFields);
+        std::unique_ptr<LasWaveformSaver> waveformSaver{nullptr};
+        if (source.saveWaveform)
+        {
+            Q_ASSERT(HasWaveform(laszipHeader.point_data_format) && pointCloud.hasFWF());
+            Q_ASSERT(waveformDataRanges != nullptr);
+            waveformSaver = std::make_unique<LasWaveformSaver>(pointCloud, *waveformDataRanges);
+        }
+
+        // Fields this cloud does not have are written as 0
+        laszipPoint = laszip_point{};
+        if (extraBytes)
+        {
+            memset(extraBytes, 0, totalExtraByteSize);
+            laszipPoint.num_extra_bytes = totalExtraByteSize;
+            laszipPoint.extra_bytes = extraBytes;
+        }
+
+        // When the cloud is expressed relatively to the LAS offset,
+        // the local coordinates can be used directly
+        const bool isRelativeToLasOffset =
+            pointCloud.getGlobalScale() == 1.0 && (pointCloud.getGlobalShift() + lasOffset).norm2() == 0.0;
+
+        const unsigned int numPoints = source.numPoints();
+        for (unsigned int j{0}; j < numPoints; ++j)
+        {
+            const unsigned int i = source.indices.empty() ? j : source.indices[j];
+
+            fieldSaver.handleScalarFields(i, laszipPoint);
+            fieldSaver.handleExtraFields(i, laszipPoint);
+
+            if (waveformSaver)
+            {
+                waveformSaver->handlePoint(i, laszipPoint);
+            }
+
+            if (source.saveRGB)
+            {
+                Q_ASSERT(HasRGB(laszipHeader.point_data_format) && pointCloud.hasColors());
+                const ccColor::Rgba &color = pointCloud.getPointColor(i);
+                laszipPoint.rgb[0] = static_cast<laszip_U16>(color.r) << 8;
+                laszipPoint.rgb[1] = static_cast<laszip_U16>(color.g) << 8;
+                laszipPoint.rgb[2] = static_cast<laszip_U16>(color.b) << 8;
+            }
+
+            const CCVector3 *point = pointCloud.getPoint(i);
+            if (isRelativeToLasOffset)
+            {
+                laszipPoint.X = static_cast<laszip_I32>(point->x / laszipHeader.x_scale_factor);
+                laszipPoint.Y = static_cast<laszip_I32>(point->y / laszipHeader.y_scale_factor);
+                laszipPoint.Z = static_cast<laszip_I32>(point->z / laszipHeader.z_scale_factor);
+            }
+            else
+            {
+                CCVector3d globalPoint = pointCloud.toGlobal3d<PointCoordinateType>(*point);
+                laszipPoint.X = static_cast<laszip_I32>((globalPoint.x - laszipHeader.x_offset) /
+                                                        laszipHeader.x_scale_factor);
+                laszipPoint.Y = static_cast<laszip_I32>((globalPoint.y - laszipHeader.y_offset) /
+                                                        laszipHeader.y_scale_factor);
+                laszipPoint.Z = static_cast<laszip_I32>((globalPoint.z - laszipHeader.z_offset) /
+                                                        laszipHeader.z_scale_factor);
+            }
+
+            if (laszip_set_point(laszipWriter, &laszipPoint) || laszip_write_point(laszipWriter) ||
+                laszip_update_inventory(laszipWriter))
+            {
+                error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+                break;
+            }
+
+            if ((j + 1) % NumPointsPerProgressUpdate == 0)
+            {
+                numWritten += NumPointsPerProgressUpdate;
+                if (cancelRequested)
+                {
+                    error = CC_FERR_CANCELED_BY_USER;
+                    break;
+                }
+            }
+        }
+
+        if (error != CC_FERR_NO_ERROR)
+        {
+            break;
+        }
+        numWritten += numPoints % NumPointsPerProgressUpdate;
+    }
+
+    if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+    {
+        laszip_get_error(laszipWriter, &errorMsg);
+        ccLog::Warning("[LAS] laszip error :'%s'", errorMsg);
+    }
+
+    delete[] extraBytes;
+    laszip_close_writer(laszipWriter);
+    laszip_clean(laszipWriter);
+    laszip_destroy(laszipWriter);
+    return error;
+}
+
+/// Writes the waveform data packets EVLR header followed by the ranges of waveform data of the cloud.
+///
+/// Small ranges are gathered in a buffer so that the data is written in large blocks.
+static bool
+WriteWaveformData(QFile &file, const ccPointCloud &pointCloud, const WaveformDataRanges &dataRanges)
+{
+    EvlrHeader header = EvlrHeader::Waveform();
+    header.recordLength = dataRanges.compactedSize();
+    {
+        QDataStream stream(&file);
+        stream << header;
+        if (stream.status() != QDataStream::Ok)
+        {
+            return false;
+        }
+    }
+
+    constexpr size_t BufferSize = 4 * 1024 * 1024;
+    std::vector<char> buffer;
+    buffer.reserve(BufferSize);
+    const auto flushBuffer = [&file, &buffer]()
+    {
+        const bool success = file.write(buffer.data(), buffer.size()) == static_cast<qint64>(buffer.size());
+        buffer.clear();
+        return success;
+    };
+
+    const char *fwfData = reinterpret_cast<const char *>(pointCloud.fwfData()->data());
+    for (const WaveformDataRanges::Range &range : dataRanges.ranges())
+    {
+        const char *rangeData = fwfData + range.begin;
+        const size_t rangeSize = range.end - range.begin;
+        if (!buffer.empty() && buffer.size() + rangeSize > BufferSize && !flushBuffer())
+        {
+            return false;
+        }
+
+        if (rangeSize >= BufferSize)
+        {
+            // No need to copy it, it is large enough on its own
+            if (file.write(rangeData, rangeSize) != static_cast<qint64>(rangeSize))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            buffer.insert(buffer.end(), rangeData, rangeData + rangeSize);
+        }
+    }
+    return buffer.empty() || flushBuffer();
+}
+
+/// Writes the ranges of waveform data of the cloud in the external
+/// waveform data packets file (.wdp) that goes with the LAS file.
+static CC_FILE_ERROR WriteWaveformDataFile(const QString &lasFilename,
+                                           const ccPointCloud &pointCloud,
+                                           const WaveformDataRanges &dataRanges)
+{
+    QFileInfo info(lasFilename);
+    QString wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.completeBaseName());
+    QFile fwfFile(wdpFilename);
+
+    if (!fwfFile.open(QIODevice::WriteOnly))
+    {
+        ccLog::Error("[LAS] Failed to write waveform data");
+        return CC_FERR_WRITING;
+    }
+
+    if (!WriteWaveformData(fwfFile, pointCloud, dataRanges))
+    {
+        ccLog::Warning(QString("[LAS] Failed to write waveform data: %1").arg(fwfFile.errorString()));
+        return CC_FERR_WRITING;
+    }
+    ccLog::Print(QString("[LAS] Successfully saved FWF in external file '%1' (%2 bytes out of %3)")
+                     .arg(wdpFilename)
+                     .arg(dataRanges.compactedSize())
+                     .arg(pointCloud.fwfData()->size()));
+    return CC_FERR_NO_ERROR;
+}
+
+/// Appends the ranges of waveform data of the cloud as an EVLR at the end of
+/// the LAS file (which must have been closed by laszip) and updates its header to point to it.
+static CC_FILE_ERROR AppendWaveformDataEvlr(const QString &lasFilename,
+                                            const laszip_header &laszipHeader,
+                                            const ccPointCloud &pointCloud,
+                                            const WaveformDataRanges &dataRanges)
+{
+    // Positions of the fields in the LAS header,
+    // the start of the first EVLR is followed by the number of EVLRs (LAS >= 1.4)
+    constexpr qint64 StartOfWaveformDataPacketRecordPos = 227;
+    constexpr qint64 StartOfFirstEvlrPos = 235;
+
+    QFile lasFile(lasFilename);
+    if (!lasFile.open(QIODevice::ReadWrite))
+    {
+        ccLog::Warning(QString("[LAS] Failed to re open the las file: %1").arg(lasFile.errorString()));
+        return CC_FERR_WRITING;
+    }
+
+    const quint64 startOfWaveformData = lasFile.size();
+    if (!lasFile.seek(startOfWaveformData) || !WriteWaveformData(lasFile, pointCloud, dataRanges))
+    {
+        ccLog::Warning(QString("[LAS] Failed to write waveform data: %1").arg(lasFile.errorString()));
+        return CC_FERR_WRITING;
+    }
+
+    QDataStream stream(&lasFile);
+    stream.setByteOrder(QDataStream::ByteOrder::LittleEndian);
+    lasFile.seek(StartOfWaveformDataPacketRecordPos);
+    stream << startOfWaveformData;
+
+    if (laszipHeader.version_minor >= 4)
+    {
+        // The waveform EVLR comes after the ones laszip may have written
+        quint64 startOfFirstEvlr{0};
+        quint32 numEvlrs{0};
+        lasFile.seek(StartOfFirstEvlrPos);
+        stream >> startOfFirstEvlr >> numEvlrs;
+        if (numEvlrs == 0)
+        {
+            startOfFirstEvlr = startOfWaveformData;
+        }
+        lasFile.seek(StartOfFirstEvlrPos);
+        stream << startOfFirstEvlr << numEvlrs + 1;
+    }
+
+    if (stream.status() != QDataStream::Ok)
+    {
+        ccLog::Warning(QString("[LAS] Failed to update the header: %1").arg(lasFile.errorString()));
+        return CC_FERR_WRITING;
+    }
+    ccLog::Print(QString("[LAS] Successfully saved FWF in '%1' (%2 bytes out of %3)")
+                     .arg(lasFilename)
+                     .arg(dataRanges.compactedSize())
+                     .arg(pointCloud.fwfData()->size()));
+    return CC_FERR_NO_ERROR;
+}
+
+static double ToMB(double numBytes)
+{
+    return numBytes / (1024.0 * 1024.0);
+}
+
+/// Reduces what is loaded from the file until the estimated memory usage fits in the budget.
+///
+/// In that order: waveforms are not loaded, extra bytes fields are not loaded,
+/// and then only one point out of `pointStep` is loaded.
+///
+/// Compact storage is not enabled here, as its fields have no scalar field until they are created
+/// from the "LAS" menu: the open dialog proposes it when the estimate is over the budget.
+static void FitInMemoryBudget(uint64_t budget,
+                              const laszip_header &header,
+                              uint64_t pointCount,
+                              const std::vector<LasScalarField> &fields,
+                              std::vector<LasExtraScalarField> &extraFields,
+                              uint64_t waveformDataSize,
+                              LasStorageOptions &options,
+                              unsigned int &pointStep)
+{
+    const auto estimate = [&]()
+    {
+        const double pointsSize =
+            EstimatedBytesPerPoint(header, fields, extraFields, options) * static_cast<double>(pointCount);
+        return pointsSize + (options.waveforms ? static_cast<double>(waveformDataSize) : 0.0);
+    };
+
+    const double initialEstimate = estimate();
+    if (initialEstimate <= budget)
+    {
+        return;
+    }
+    ccLog::Warning(QString("[LAS] The cloud would use about %1 MB, over the memory budget of %2 MB")
+                       .arg(ToMB(initialEstimate), 0, 'f', 0)
+                       .arg(ToMB(budget), 0, 'f', 0));
+
+    if (options.waveforms)
+    {
+        options.waveforms = false;
+        ccLog::Warning("[LAS] Waveforms are not loaded to fit the memory budget");
+        if (estimate() <= budget)
+        {
+            return;
+        }
+    }
+
+    if (!extraFields.empty())
+    {
+        extraFields.clear();
+        ccLog::Warning("[LAS] Extra bytes fields are not loaded to fit the memory budget");
+        if (estimate() <= budget)
+        {
+            return;
+        }
+    }
+
+    pointStep = static_cast<unsigned int>(std::ceil(estimate() / static_cast<double>(budget)));
+    ccLog::Warning(QString("[LAS] Only one point out of %1 is loaded to fit the memory budget, "
+                           "the cloud will use about %2 MB")
+                       .arg(pointStep)
+                       .arg(ToMB(estimate() / pointStep), 0, 'f', 0));
+}
+
+/// Finishes the loading of the scalar field(s) of a single field by a loader.
+///
+/// If the loading failed the scalar fields are removed, leaving the cloud as it was.
+static CC_FILE_ERROR AddLoadedField(ccPointCloud &pointCloud,
+                                    const LasScalarFieldLoader &loader,
+                                    const QString &fieldName,
+                                    CC_FILE_ERROR error)
+{
+    std::vector<ccScalarField *> newScalarFields;
+    for (const LasScalarField &field : loader.standardFields())
+    {
+        newScalarFields.push_back(field.sf);
+    }
+    for (const LasExtraScalarField &extraField : loader.extraFields())
+    {
+        newScalarFields.insert(newScalarFields.end(),
+                               std::begin(extraField.scalarFields),
+                               std::begin(extraField.scalarFields) + extraField.numElements());
+    }
+
+    if (error != CC_FERR_NO_ERROR)
+    {
+        // Leave the cloud as it was
+        for (ccScalarField *sf : newScalarFields)
+        {
+            for (unsigned int j{0}; j < pointCloud.getNumberOfScalarFields(); ++j)
+            {
+                if (pointCloud.getScalarField(static_cast<int>(j)) == sf)
+                {
+                    pointCloud.deleteScalarField(static_cast<int>(j));
+                    break;
+                }
+            }
+        }
+        return error;
+    }
+
+    if (!loader.standardFields().empty())
+    {
+        if (loader.standardFields().front().sf == nullptr)
+        {
+            ccLog::Print(
+                QString("[LAS] All the values of '%1' are 0, no scalar field was created").arg(fieldName));
+        }
+        SetupLoadedScalarFields(pointCloud, loader.standardFields());
+    }
+    else
+    {
+        for (ccScalarField *sf : newScalarFields)
+        {
+            sf->computeMinAndMax();
+        }
+
+        // So that the field is saved back as an extra bytes field
+        auto savedInfo = qvariant_cast<LasSavedInfo>(pointCloud.getMetaData(LAS_METADATA_INFO_KEY));
+        LasExtraScalarField extraField = loader.extraFields().front();
+        extraField.resetScalarFieldsPointers();
+        savedInfo.extraScalarFields.push_back(extraField);
+        pointCloud.setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(savedInfo));
+    }
+
+    return CC_FERR_NO_ERROR;
+}
+
+QStringList LasIOFilter::PendingFieldNames(const ccPointCloud &pointCloud)
+{
+    QStringList names;
+    if (pointCloud.hasMetaData(LAS_COMPACT_FIELDS_KEY))
+    {
+        for (const LasCompactField &compactField :
+             *qvariant_cast<QSharedPointer<LasCompactFields>>(pointCloud.getMetaData(LAS_COMPACT_FIELDS_KEY)))
+        {
+            names.append(compactField.name());
+        }
+    }
+    if (pointCloud.hasMetaData(LAS_DEFERRED_FIELDS_KEY))
+    {
+        const auto deferredFields =
+            qvariant_cast<QSharedPointer<LasDeferredFields>>(pointCloud.getMetaData(LAS_DEFERRED_FIELDS_KEY));
+        for (const LasScalarField &field : deferredFields->standardFields)
+        {
+            names.append(field.name());
+        }
+        for (const LasExtraScalarField &extraField : deferredFields->extraFields)
+        {
+            names.append(extraField.name);
+        }
+    }
+    return names;
+}
+
+static bool HasDeferredField(const LasDeferredFields &deferredFields, const QString &fieldName)
+{
+    return std::any_of(deferredFields.standardFields.begin(),
+                       deferredFields.standardFields.end(),
+                       [&fieldName](const LasScalarField &field) { return fieldName == field.name(); }) ||
+           std::any_of(deferredFields.extraFields.begin(),
+                       deferredFields.extraFields.end(),
+                       [&fieldName](const LasExtraScalarField &field) { return fieldName == field.name; });
+}
+
+/// Creates the scalar field(s) of a field loaded on demand from the point records.
+///
+/// Unless `keepPending` is set, the field is no longer pending once created,
+/// and the records are released once all the fields were created.
+static CC_FILE_ERROR CreateDeferredField(ccPointCloud &pointCloud,
+                                         LasDeferredFields &deferredFields,
+                                         const QString &fieldName,
+                                         bool keepPending)
+{
+    auto standardIt =
+        std::find_if(deferredFields.standardFields.begin(),
+                     deferredFields.standardFields.end(),
+                     [&fieldName](const LasScalarField &field) { return fieldName == field.name(); });
+    auto extraIt =
+        std::find_if(deferredFields.extraFields.begin(),
+                     deferredFields.extraFields.end(),
+                     [&fieldName](const LasExtraScalarField &field) { return fieldName == field.name; });
+    const auto removeField = [&]()
+    {
+        if (standardIt != deferredFields.standardFields.end())
+        {
+            deferredFields.standardFields.erase(standardIt);
+        }
+        else
+        {
+            deferredFields.extraFields.erase(extraIt);
+        }
+        if (deferredFields.standardFields.empty() && deferredFields.extraFields.empty())
+        {
+            pointCloud.removeMetaData(LAS_DEFERRED_FIELDS_KEY);
+        }
+    };
+
+    if (deferredFields.records.size() != pointCloud.size())
+    {
+        ccLog::Warning(QString("[LAS] The points of the cloud changed, the records of '%1' are discarded")
+                           .arg(fieldName));
+        removeField();
+        return CC_FERR_BAD_ARGUMENT;
+    }
+
+    std::vector<LasScalarField> standardFields;
+    std::vector<LasExtraScalarField> extraFields;
+    if (standardIt != deferredFields.standardFields.end())
+    {
+        standardFields.push_back(*standardIt);
+    }
+    else
+    {
+        extraFields.push_back(*extraIt);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    LasScalarFieldLoader loader(standardFields, extraFields, pointCloud);
+
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Creating LAS field");
+    progressDialog.setInfo(QString("Creating '%1'").arg(fieldName));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCloud.size());
+    constexpr unsigned int NumPointsPerProgressUpdate = 4096;
+    progressDialog.start();
+
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    laszip_point point{};
+    for (unsigned int i{0}; i < pointCloud.size(); ++i)
+    {
+        deferredFields.records.restore(i, point);
+        error = loader.handleFields(pointCloud, i, point);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            break;
+        }
+
+        if ((i + 1) % NumPointsPerProgressUpdate == 0 && !normProgress.steps(NumPointsPerProgressUpdate))
+        {
+            error = CC_FERR_CANCELED_BY_USER;
+            break;
+        }
+    }
+
+    error = AddLoadedField(pointCloud, loader, fieldName, error);
+    if (error == CC_FERR_NO_ERROR)
+    {
+        // On failure the records are kept so that the field can be created later
+        if (!keepPending)
+        {
+            removeField();
+        }
+        LogElapsedTime(timer);
+    }
+    return error;
+}
+
+/// Creates the scalar field of a field in compact storage or created on demand.
+///
+/// Unless `keepPending` is set, the field is no longer pending once created
+/// and its compact values (or point records) are released.
+static CC_FILE_ERROR CreatePendingField(ccPointCloud &pointCloud, const QString &fieldName, bool keepPending)
+{
+    if (pointCloud.hasMetaData(LAS_DEFERRED_FIELDS_KEY))
+    {
+        const auto deferredFields =
+            qvariant_cast<QSharedPointer<LasDeferredFields>>(pointCloud.getMetaData(LAS_DEFERRED_FIELDS_KEY));
+        if (HasDeferredField(*deferredFields, fieldName))
+        {
+            return CreateDeferredField(pointCloud, *deferredFields, fieldName, keepPending);
+        }
+    }
+
+    if (!pointCloud.hasMetaData(LAS_COMPACT_FIELDS_KEY))
+    {
+        ccLog::Warning(
+            QString("[LAS] The cloud has no field named '%1' waiting to be created").arg(fieldName));
+        return CC_FERR_BAD_ARGUMENT;
+    }
+    const auto compactFields =
+        qvariant_cast<QSharedPointer<LasCompactFields>>(pointCloud.getMetaData(LAS_COMPACT_FIELDS_KEY));
+
+    auto it = std::find_if(compactFields->begin(),
+                           compactFields->end(),
+                           [&fieldName](const LasCompactField &field) { return fieldName == field.name(); });
+    if (it == compactFields->end())
+    {
+        ccLog::Warning(
+            QString("[LAS] The cloud has no field named '%1' waiting to be created").arg(fieldName));
+        return CC_FERR_BAD_ARGUMENT;
+    }
+
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    if (it->size() != pointCloud.size())
+    {
+        ccLog::Warning(
+            QString("[LAS] The points of the cloud changed, the compact values of '%1' are discarded")
+                .arg(fieldName));
+        error = CC_FERR_BAD_ARGUMENT;
+    }
+    else
+    {
+        ccScalarField *sf = it->toScalarField();
+        if (sf == nullptr)
+        {
+            return CC_FERR_NOT_ENOUGH_MEMORY;
+        }
+        pointCloud.addScalarField(sf);
+        SetupLoadedScalarFields(pointCloud, {LasScalarField(it->id(), sf)});
+        if (keepPending)
+        {
+            return CC_FERR_NO_ERROR;
+        }
+    }
+
+    compactFields->erase(it);
+    if (compactFields->empty())
+    {
+        pointCloud.removeMetaData(LAS_COMPACT_FIELDS_KEY);
+    }
+    return error;
+}
+
+/// Scalar fields created for the pending fields of the clouds being saved,
+/// so that they are written like the other fields.
+///
+/// The clouds are restored as they were when this goes out of scope:
+/// the fields are still pending, and the displayed field and saved info are unchanged.
+class TemporaryPendingFields
+{
+  public:
+    TemporaryPendingFields() = default;
+    TemporaryPendingFields(const TemporaryPendingFields &) = delete;
+    TemporaryPendingFields &operator=(const TemporaryPendingFields &) = delete;
+
+    ~TemporaryPendingFields()
+    {
+        for (const CloudState &state : m_states)
+        {
+            ccPointCloud &pointCloud = *state.pointCloud;
+            while (pointCloud.getNumberOfScalarFields() > state.numScalarFields)
+            {
+                pointCloud.deleteScalarField(static_cast<int>(pointCloud.getNumberOfScalarFields() - 1));
+            }
+            pointCloud.setCurrentDisplayedScalarField(state.displayedScalarField);
+            pointCloud.showSF(state.sfShown);
+            pointCloud.showColors(state.colorsShown);
+            pointCloud.setMetaData(LAS_METADATA_INFO_KEY, state.savedInfo);
+        }
+    }
+
+    /// Creates the scalar fields of the pending fields of the cloud.
+    CC_FILE_ERROR create(ccPointCloud &pointCloud)
+    {
+        const QStringList names = LasIOFilter::PendingFieldNames(pointCloud);
+        if (names.isEmpty())
+        {
+            return CC_FERR_NO_ERROR;
+        }
+
+        m_states.push_back({&pointCloud,
+                            pointCloud.getNumberOfScalarFields(),
+                            pointCloud.getCurrentDisplayedScalarFieldIndex(),
+                            pointCloud.sfShown(),
+                            pointCloud.colorsShown(),
+                            pointCloud.getMetaData(LAS_METADATA_INFO_KEY)});
+        for (const QString &name : names)
+        {
+            if (CreatePendingField(pointCloud, name, true) == CC_FERR_NOT_ENOUGH_MEMORY)
+            {
+                return CC_FERR_NOT_ENOUGH_MEMORY;
+            }
+        }
+        return CC_FERR_NO_ERROR;
+    }
+
+  private:
+    struct CloudState
+    {
+        ccPointCloud *pointCloud;
+        unsigned int numScalarFields;
+        int displayedScalarField;
+        bool sfShown;
+        bool colorsShown;
+        /// Pending extra bytes fields are added to it when created
+        QVariant savedInfo;
+    };
+
+    std::vector<CloudState> m_states;
+};
+
+/// Loads a coarse cloud made of runs of points spread through the file,
+/// and lets the event loop append the remaining points to it.
+///
+/// The loader takes the ownership of the reader.
+static CC_FILE_ERROR LoadProgressively(const QString &fileName,
+                                       laszip_POINTER laszipReader,
+                                       const laszip_header &laszipHeader,
+                                       laszip_point &laszipPoint,
+                                       std::vector<LasScalarField> scalarFields,
+                                       std::vector<LasExtraScalarField> extraScalarFields,
+                                       ccHObject &container,
+                                       FileIOFilter::LoadParameters &parameters)
+{
+    /// 64 runs of 4096 points, so that the coarse cloud has ~250k points
+    constexpr unsigned int NumCoarseRuns = 64;
+    constexpr unsigned int CoarseRunLength = 4096;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    laszip_F64 laszipCoordinates[3];
+    if (laszip_read_point(laszipReader) || laszip_get_coordinates(laszipReader, laszipCoordinates))
+    {
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+    const CCVector3d firstPoint(laszipCoordinates[0], laszipCoordinates[1], laszipCoordinates[2]);
+
+    bool preserveGlobalShift{true};
+    CCVector3d lasMins(laszipHeader.min_x, laszipHeader.min_y, laszipHeader.min_z);
+    CCVector3d shift = GetGlobalShift(parameters, preserveGlobalShift, lasMins, firstPoint);
+    if (shift.norm2() != 0.0)
+    {
+        ccLog::Warning(
+            "[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)", shift.x, shift.y, shift.z);
+    }
+
+    auto pointCloud = std::make_unique<ccPointCloud>(QFileInfo(fileName).fileName());
+    pointCloud->setGlobalShift(shift);
+
+    std::vector<LasExtraScalarField> savedExtraFields = extraScalarFields;
+    auto loader = QSharedPointer<LasProgressiveLoader>::create(laszipReader,
+                                                               laszipHeader,
+                                                               laszipPoint,
+                                                               *pointCloud,
+                                                               shift,
+                                                               std::move(scalarFields),
+                                                               std::move(extraScalarFields));
+    const CC_FILE_ERROR error = loader->loadCoarse(NumCoarseRuns, CoarseRunLength);
+    if (error != CC_FERR_NO_ERROR)
+    {
+        return error;
+    }
+    SetupLoadedScalarFields(*pointCloud, loader->fieldLoader().standardFields());
+
+    for (LasExtraScalarField &extraField : savedExtraFields)
+    {
+        extraField.resetScalarFieldsPointers();
+    }
+    LasSavedInfo info(laszipHeader);
+    info.extraScalarFields = savedExtraFields;
+    if (!loader->isDone())
+    {
+        // The points are not in the order of the file, fields cannot be reloaded from it
+        info.numPoints = 0;
+    }
+    pointCloud->setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(info));
+
+    if (!loader->isDone())
+    {
+        ccLog::Print(QString("[LAS] Showing %1 points of '%2', "
+                             "the remaining points are loaded by batches from the event loop")
+                         .arg(pointCloud->size())
+                         .arg(fileName));
+        ccPointCloud *cloud = pointCloud.get();
+        loader->setOnFinished([cloud](const LasScalarFieldLoader &fieldLoader)
+                              { SetupLoadedScalarFields(*cloud, fieldLoader.standardFields()); });
+        LasProgressiveLoader::LoadRemainingPoints(loader);
+    }
+    container.addChild(pointCloud.release());
+
+    LogElapsedTime(timer);
+    return CC_FERR_NO_ERROR;
+}
+
+/// Creates a placeholder from the header of the file only,
+/// the points are loaded by `LoadPlaceholderPoints` from the "LAS" menu.
+static CC_FILE_ERROR CreatePlaceholder(const QString &fileName,
+                                       const laszip_header &laszipHeader,
+                                       const std::vector<LasScalarField> &scalarFields,
+                                       std::vector<LasExtraScalarField> extraScalarFields,
+                                       ccHObject &container,
+                                       FileIOFilter::LoadParameters &parameters)
+{
+    const CCVector3d lasMins(laszipHeader.min_x, laszipHeader.min_y, laszipHeader.min_z);
+    const CCVector3d lasMaxs(laszipHeader.max_x, laszipHeader.max_y, laszipHeader.max_z);
+
+    bool preserveGlobalShift{true};
+    CCVector3d shift = GetGlobalShift(parameters, preserveGlobalShift, lasMins, lasMins);
+    if (shift.norm2() != 0.0)
+    {
+        ccLog::Warning(
+            "[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)", shift.x, shift.y, shift.z);
+    }
+
+    ccBBox box;
+    for (const CCVector3d &corner : {lasMins, lasMaxs})
+    {
+        box.add(CCVector3(static_cast<PointCoordinateType>(corner.x + shift.x),
+                          static_cast<PointCoordinateType>(corner.y + shift.y),
+                          static_cast<PointCoordinateType>(corner.z + shift.z)));
+    }
+
+    const std::vector<LasExtraScalarField> extraFieldsToLoad = extraScalarFields;
+    for (LasExtraScalarField &extraField : extraScalarFields)
+    {
+        extraField.resetScalarFieldsPointers();
+    }
+    LasSavedInfo info(laszipHeader);
+    info.extraScalarFields = std::move(extraScalarFields);
+
+    container.addChild(new LasPlaceholder(fileName, box, shift, scalarFields, extraFieldsToLoad, info));
+    LasPendingDataMenu::Install();
+    ccLog::Print(QString("[LAS] The %1 points of '%2' can be loaded from the 'LAS' menu")
+                     .arg(PointCount(laszipHeader))
+                     .arg(QFileInfo(fileName).fileName()));
+    return CC_FERR_NO_ERROR;
+}
+
+LasIOFilter::LasIOFilter()
+    : FileIOFilter({"LAS IO Filter",
+                    DEFAULT_PRIORITY, // priority
+                    QStringList{"las", "laz"},
+                    "laz",
+                    QStringList{"LAS file (*.las *.laz)"},
+                    QStringList{"LAS file (*.las *.laz)"},
+                    Import | Export})
+{
+}
+
+CC_FILE_ERROR LasIOFilter::loadFile(const QString &fileName, ccHObject &container, LoadParameters &parameters)
+{
+    laszip_POINTER laszipReader{};
+    laszip_header *laszipHeader{nullptr};
+    laszip_BOOL isCompressed{false};
+    laszip_CHAR *errorMsg{nullptr};
+
+    if (laszip_create(&laszipReader))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    if (laszip_open_reader(laszipReader, qPrintable(fileName), &isCompressed))
+    {
+        laszip_get_error(laszipHeader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    if (laszip_get_header_pointer(laszipReader, &laszipHeader))
+    {
+        laszip_get_error(laszipHeader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        laszip_close_reader(laszipReader);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    laszip_U64 pointCount = PointCount(*laszipHeader);
+
+    if (pointCount >= std::numeric_limits<unsigned int>::max())
+    {
+        // TODO
+        ccLog::Error("Files with more that %lu points are not supported", pointCount);
+        return CC_FERR_NOT_IMPLEMENTED;
+    }
+
+    std::vector<LasScalarField> availableScalarFields =
+        LasScalarFieldForPointFormat(laszipHeader->point_data_format);
+
+    std::vector<LasExtraScalarField> availableEXtraScalarFields =
+        LasExtraScalarField::ParseExtraScalarFields(*laszipHeader);
+
+    LasOpenDialog dialog;
+    dialog.setInfo(laszipHeader->version_minor, laszipHeader->point_data_format, pointCount);
+    dialog.setAvailableScalarFields(availableScalarFields, availableEXtraScalarFields);
+    dialog.setEstimateInfo(*laszipHeader, isCompressed);
+    dialog.setPreviewFileName(fileName);
+    dialog.exec();
+    if (dialog.result() == QDialog::Rejected)
+    {
+        laszip_close_reader(laszipReader);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+        return CC_FERR_CANCELED_BY_USER;
+    }
+
+    // The dialog disables the options that only apply to a single cloud when merging or splitting
+    const QStringList filesToMerge = dialog.filesToMerge();
+    if (!filesToMerge.isEmpty())
+    {
+        CloseLaszipReader(laszipReader);
+        return LoadMergedFiles(QStringList(fileName) + filesToMerge, dialog, container, parameters);
+    }
+
+    dialog.filterOutNotChecked(availableScalarFields, availableEXtraScalarFields);
+    const QString splitFieldName = dialog.splitFieldName();
+
+    if (dialog.shouldDeferLoading())
+    {
+        const CC_FILE_ERROR error = CreatePlaceholder(fileName,
+                                                      *laszipHeader,
+                                                      availableScalarFields,
+                                                      availableEXtraScalarFields,
+                                                      container,
+                                                      parameters);
+        CloseLaszipReader(laszipReader);
+        return error;
+    }
+
+    const bool loadProgressively = dialog.shouldLoadProgressively() && splitFieldName.isEmpty();
+    if (loadProgressively &&
+        (dialog.shouldUseCompactStorage() || dialog.shouldCreateFieldsOnDemand() ||
+         dialog.memoryBudget() != 0 || dialog.lastPointToLoad() - dialog.firstPointToLoad() != pointCount))
+    {
+        ccLog::Warning(
+            "[LAS] When showing a coarse cloud first, all the points are loaded into scalar fields");
+    }
+    if (loadProgressively && HasWaveform(laszipHeader->point_data_format))
+    {
+        ccLog::Warning("[LAS] Waveforms are not loaded when showing a coarse cloud first");
+    }
+
+    // Only the points in [firstPointIndex, firstPointIndex + numPointsInWindow) are loaded
+    const uint64_t firstPointIndex = splitFieldName.isEmpty() ? dialog.firstPointToLoad() : 0;
+    const uint64_t numPointsInWindow =
+        splitFieldName.isEmpty() ? dialog.lastPointToLoad() - firstPointIndex : pointCount;
+    if (numPointsInWindow == 0)
+    {
+        ccLog::Warning("[LAS] The range of points to load is empty");
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_NO_LOAD;
+    }
+
+    LasStorageOptions storageOptions;
+    storageOptions.compactStorage = dialog.shouldUseCompactStorage();
+    storageOptions.fieldsOnDemand = dialog.shouldCreateFieldsOnDemand();
+    storageOptions.waveforms = HasWaveform(laszipHeader->point_data_format);
+    std::unique_ptr<LasWaveformLoader> waveformLoader{nullptr};
+    unsigned int pointStep{1};
+    if (splitFieldName.isEmpty() && !loadProgressively)
+    {
+        if (storageOptions.waveforms)
+        {
+            waveformLoader = std::make_unique<LasWaveformLoader>(*laszipHeader, fileName);
+        }
+        if (dialog.memoryBudget() != 0)
+        {
+            FitInMemoryBudget(dialog.memoryBudget(),
+                              *laszipHeader,
+                              numPointsInWindow,
+                              availableScalarFields,
+                              availableEXtraScalarFields,
+                              waveformLoader ? waveformLoader->fwfDataCount : 0,
+                              storageOptions,
+                              pointStep);
+            if (!storageOptions.waveforms)
+            {
+                waveformLoader.reset();
+            }
+        }
+    }
+
+    // Only decompress the fields that are loaded (and the one used to split the cloud)
+    std::vector<LasScalarField> fieldsToDecompress = availableScalarFields;
+    if (!splitFieldName.isEmpty())
+    {
+        fieldsToDecompress.emplace_back(
+            LasScalarField::IdFromName(qPrintable(splitFieldName), laszipHeader->point_data_format));
+    }
+    laszip_point *laszipPoint{nullptr};
+    if (!ReopenWithSelectiveDecompression(laszipReader,
+                                          fileName,
+                                          isCompressed,
+                                          fieldsToDecompress,
+                                          availableEXtraScalarFields,
+                                          laszipHeader,
+                                          laszipPoint))
+    {
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    if (!splitFieldName.isEmpty())
+    {
+        CC_FILE_ERROR error{CC_FERR_THIRD_PARTY_LIB_FAILURE};
+        if (laszip_get_point_pointer(laszipReader, &laszipPoint) == 0)
+        {
+            const LasScalarField::Id splitId =
+                LasScalarField::IdFromName(qPrintable(splitFieldName), laszipHeader->point_data_format);
+            error = LoadSplitFile(fileName,
+                                  laszipReader,
+                                  *laszipHeader,
+                                  *laszipPoint,
+                                  static_cast<unsigned int>(pointCount),
+                                  splitId,
+                                  availableScalarFields,
+                                  availableEXtraScalarFields,
+                                  container,
+                                  parameters);
+        }
+        if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+        {
+            laszip_get_error(laszipReader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        }
+        CloseLaszipReader(laszipReader);
+        return error;
+    }
+
+    if (loadProgressively)
+    {
+        if (laszip_get_point_pointer(laszipReader, &laszipPoint))
+        {
+            laszip_get_error(laszipReader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+            CloseLaszipReader(laszipReader);
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+        return LoadProgressively(fileName,
+                                 laszipReader,
+                                 *laszipHeader,
+                                 *laszipPoint,
+                                 availableScalarFields,
+                                 availableEXtraScalarFields,
+                                 container,
+                                 parameters);
+    }
+
+    if (firstPointIndex != 0 && laszip_seek_point(laszipReader, static_cast<laszip_I64>(firstPointIndex)))
+    {
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    // One point out of pointStep is loaded
+    const auto numPointsToLoad = static_cast<unsigned int>((numPointsInWindow + pointStep - 1) / pointStep);
+    QString cloudName = QFileInfo(fileName).fileName();
+    if (numPointsInWindow != pointCount)
+    {
+        cloudName += QString(" [%1, %2)").arg(firstPointIndex).arg(firstPointIndex + numPointsInWindow);
+    }
+    auto pointCloud = std::make_unique<ccPointCloud>(cloudName);
+    if (!pointCloud->resize(numPointsToLoad))
+    {
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+
+    CCVector3d lasMins(laszipHeader->min_x, laszipHeader->min_y, laszipHeader->min_z);
+
+    laszip_F64 laszipCoordinates[3];
+    CCVector3d shift;
+    bool preserveGlobalShift{true};
+
+    if (laszip_get_point_pointer(laszipReader, &laszipPoint))
+    {
+        laszip_get_error(laszipHeader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        laszip_close_reader(laszipReader);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    // Integer fields kept in compact storage are not given to the scalar field loader
+    std::vector<LasCompactField> compactFields;
+    if (storageOptions.compactStorage)
+    {
+        const auto isCompactable = [](const LasScalarField &field)
+        { return LasCompactField::IsSupported(field.id); };
+        try
+        {
+            for (const LasScalarField &field : availableScalarFields)
+            {
+                if (isCompactable(field))
+                {
+                    compactFields.emplace_back(field.id, numPointsToLoad);
+                }
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            CloseLaszipReader(laszipReader);
+            return CC_FERR_NOT_ENOUGH_MEMORY;
+        }
+        availableScalarFields.erase(
+            std::remove_if(availableScalarFields.begin(), availableScalarFields.end(), isCompactable),
+            availableScalarFields.end());
+    }
+
+    // The remaining fields are only kept as point records, their scalar fields are created on demand
+    QSharedPointer<LasDeferredFields> deferredFields;
+    if (storageOptions.fieldsOnDemand &&
+        (!availableScalarFields.empty() || !availableEXtraScalarFields.empty()))
+    {
+        deferredFields = QSharedPointer<LasDeferredFields>::create(*laszipHeader);
+        if (!deferredFields->records.allocate(numPointsToLoad))
+        {
+            CloseLaszipReader(laszipReader);
+            return CC_FERR_NOT_ENOUGH_MEMORY;
+        }
+        deferredFields->standardFields = std::move(availableScalarFields);
+        deferredFields->extraFields = std::move(availableEXtraScalarFields);
+        availableScalarFields.clear();
+        availableEXtraScalarFields.clear();
+    }
+
+    LasScalarFieldLoader loader(availableScalarFields, availableEXtraScalarFields, *pointCloud);
+    if (waveformLoader && !waveformLoader->prepare(*pointCloud))
+    {
+        waveformLoader.reset();
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Loading LAS points");
+    progressDialog.setInfo("Loading points");
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, numPointsInWindow);
+    unsigned int numStepsForUpdate = 1 * numPointsInWindow / 100;
+    unsigned int lastProgressUpdate = 0;
+    progressDialog.start();
+
+    const bool hasRGB = HasRGB(laszipHeader->point_data_format);
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    unsigned int i{0};
+    for (; i < numPointsInWindow; ++i)
+    {
+        if (progressDialog.isCancelRequested())
+        {
+            error = CC_FERR_CANCELED_BY_USER;
+            break;
+        }
+
+        if ((i - lastProgressUpdate) == numStepsForUpdate)
+        {
+            normProgress.steps(i - lastProgressUpdate);
+            lastProgressUpdate += (i - lastProgressUpdate);
+        }
 
-    QDate currentDate = QDate::currentDate();
-    laszipHeader.file_creation_year = currentDate.year();
-    laszipHeader.file_creation_day = currentDate.dayOfYear();
+        if (laszip_read_point(laszipReader))
+        {
+            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            break;
+        }
 
-    laszipHeader.version_major = 1;
-    laszipHeader.version_minor = saveDialog.selectedVersionMinor();
-    laszipHeader.point_data_format = saveDialog.selectedPointFormat();
+        if (i % pointStep != 0)
+        {
+            continue;
+        }
+        const unsigned int pointIndex = i / pointStep;
 
-    // TODO global encoding wkt and other
-    if (HasWaveform(laszipHeader.point_data_format) && pointCloud.hasFWF())
-    {
-        // We always store FWF externally
-        laszipHeader.global_encoding |= 0b0000'0100;
-    }
+        if (i == 0)
+        {
+            if (laszip_get_coordinates(laszipReader, laszipCoordinates))
+            {
+                error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+                break;
+            }
+            CCVector3d firstPoint(laszipCoordinates[0], laszipCoordinates[1], laszipCoordinates[2]);
+            shift = GetGlobalShift(parameters, preserveGlobalShift, lasMins, firstPoint);
 
-    laszipHeader.header_size = HeaderSize(laszipHeader.version_minor);
-    laszipHeader.offset_to_point_data = laszipHeader.header_size;
-    laszipHeader.point_data_record_length = PointFormatSize(laszipHeader.point_data_format);
+            if (preserveGlobalShift)
+            {
+                pointCloud->setGlobalShift(shift);
+            }
 
-    CCVector3d lasScale = saveDialog.chosenScale();
-    laszipHeader.x_scale_factor = lasScale.x;
-    laszipHeader.y_scale_factor = lasScale.y;
-    laszipHeader.z_scale_factor = lasScale.z;
+            if (shift.norm2() != 0.0)
+            {
+                ccLog::Warning("[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)",
+                               shift.x,
+                               shift.y,
+                               shift.z);
+            }
+            pointCloud->setGlobalShift(shift);
+        }
 
-    laszipHeader.file_source_ID = savedInfo.fileSourceId;
-    laszipHeader.project_ID_GUID_data_1 = savedInfo.guidData1;
-    laszipHeader.project_ID_GUID_data_2 = savedInfo.guidData2;
-    laszipHeader.project_ID_GUID_data_3 = savedInfo.guidData3;
-    strncpy(laszipHeader.project_ID_GUID_data_4, savedInfo.guidData4, 8);
-    strncpy(laszipHeader.system_identifier, savedInfo.systemIdentifier, 32);
-    strncpy(laszipHeader.generating_software, "CloudCompare", 32);
+        error = loader.loadPoint(laszipReader, *laszipPoint, shift, hasRGB, *pointCloud, pointIndex);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            break;
+        }
 
-    if (savedInfo.extraScalarFields.empty())
+        try
+        {
+            for (LasCompactField &compactField : compactFields)
+            {
+                compactField.setValue(pointIndex,
+                                      static_cast<int32_t>(
+                                          LasScalarField::ValueFrom(compactField.id(), *laszipPoint)));
+            }
+        }
+        catch (const std::bad_alloc &)
+        {
+            error = CC_FERR_NOT_ENOUGH_MEMORY;
+            break;
+        }
+
+        if (deferredFields)
+        {
+            deferredFields->records.store(pointIndex, *laszipPoint);
+        }
+
+        if (waveformLoader)
+        {
+            waveformLoader->loadWaveform(*pointCloud, pointIndex, *laszipPoint);
+        }
+    }
+
+    if (waveformLoader)
     {
-        // 'steal' saved vlrs
-        laszipHeader.number_of_variable_length_records = savedInfo.numVlrs;
-        laszipHeader.vlrs = savedInfo.vlrs;
-        savedInfo.numVlrs = 0;
-        savedInfo.vlrs = nullptr;
+        waveformLoader->transferDataTo({pointCloud.get()});
     }
-    else
+
+    if (i < numPointsInWindow)
     {
-        laszipHeader.number_of_variable_length_records = savedInfo.numVlrs + 1;
-        laszipHeader.vlrs = new laszip_vlr_struct[laszipHeader.number_of_variable_length_records];
-        for (laszip_U32 i{0}; i < savedInfo.numVlrs; i++)
+        // Loading was interrupted, only keep the points that were loaded
+        const unsigned int numLoadedPoints = (i + pointStep - 1) / pointStep;
+        pointCloud->resize(numLoadedPoints);
+        for (LasCompactField &compactField : compactFields)
         {
-            cloneVlrInto(savedInfo.vlrs[i], laszipHeader.vlrs[i]);
+            compactField.resize(numLoadedPoints);
+        }
+        if (deferredFields)
+        {
+            deferredFields->records.resize(numLoadedPoints);
         }
+    }
 
-        LasExtraScalarField::InitExtraBytesVlr(
-            laszipHeader.vlrs[laszipHeader.number_of_variable_length_records - 1],
-            savedInfo.extraScalarFields);
+    SetupLoadedScalarFields(*pointCloud, loader.standardFields());
+
+    if (!compactFields.empty())
+    {
+        size_t compactSize{0};
+        for (const LasCompactField &compactField : compactFields)
+        {
+            compactSize += compactField.memoryUsage();
+            switch (compactField.layout())
+            {
+            case LasCompactField::Layout::Constant:
+                ccLog::Print(QString("[LAS] %1 is constant").arg(compactField.name()));
+                break;
+            case LasCompactField::Layout::Sparse:
+                ccLog::Print(QString("[LAS] %1 is sparse").arg(compactField.name()));
+                break;
+            case LasCompactField::Layout::Dense:
+                break;
+            }
+        }
+        ccLog::Print(QString("[LAS] %1 fields kept in compact storage: %2 MB instead of %3 MB")
+                         .arg(compactFields.size())
+                         .arg(compactSize / (1024.0 * 1024.0), 0, 'f', 1)
+                         .arg(compactFields.size() * pointCloud->size() * sizeof(ScalarType) /
+                                  (1024.0 * 1024.0),
+                              0,
+                              'f',
+                              1));
+        pointCloud->setMetaData(
+            LAS_COMPACT_FIELDS_KEY,
+            QVariant::fromValue(QSharedPointer<LasCompactFields>::create(std::move(compactFields))));
     }
 
-    laszipHeader.offset_to_point_data +=
-        SizeOfVlrs(laszipHeader.vlrs, laszipHeader.number_of_variable_length_records);
+    if (deferredFields)
+    {
+        ccLog::Print(QString("[LAS] %1 fields will be created on demand from %2 MB of point records%3")
+                         .arg(deferredFields->standardFields.size() + deferredFields->extraFields.size())
+                         .arg(ToMB(deferredFields->records.byteSize()), 0, 'f', 1)
+                         .arg(deferredFields->records.isFileBacked() ? " (in a temporary file)" : ""));
+        pointCloud->setMetaData(LAS_DEFERRED_FIELDS_KEY, QVariant::fromValue(deferredFields));
+    }
 
-    if (pointCloud.isShifted())
+    if (!PendingFieldNames(*pointCloud).isEmpty())
     {
-        laszipHeader.x_offset = -pointCloud.getGlobalShift().x;
-        laszipHeader.y_offset = -pointCloud.getGlobalShift().y;
-        laszipHeader.z_offset = -pointCloud.getGlobalShift().z;
+        LasPendingDataMenu::Install();
+        ccLog::Print("[LAS] The scalar fields of these fields can be created from the 'LAS' menu");
     }
-    else
+
+    for (LasExtraScalarField &extraField : availableEXtraScalarFields)
     {
-        CCVector3 bbMax;
-        CCVector3 bbMin;
-        pointCloud.getBoundingBox(bbMin, bbMax);
-        laszipHeader.x_offset = bbMin.x;
-        laszipHeader.y_offset = bbMin.y;
-        laszipHeader.z_offset = bbMin.z;
+        extraField.resetScalarFieldsPointers();
     }
 
-    LasExtraScalarField::MatchExtraBytesToScalarFields(savedInfo.extraScalarFields, pointCloud);
-    LasExtraScalarField::UpdateByteOffsets(savedInfo.extraScalarFields);
-    unsigned int totalExtraByteSize = LasExtraScalarField::TotalExtraBytesSize(savedInfo.extraScalarFields);
-    laszipHeader.point_data_record_length += totalExtraByteSize;
-    return laszipHeader;
+    LasSavedInfo info(*laszipHeader);
+    info.extraScalarFields = availableEXtraScalarFields;
+    pointCloud->setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(info));
+
+    container.addChild(pointCloud.release());
+
+    if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+    {
+        laszip_get_error(laszipHeader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        laszip_close_reader(laszipReader);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+    }
+
+    LogElapsedTime(timer);
+    if (error == CC_FERR_NO_ERROR)
+    {
+        // So that the open dialog can predict the time the next loads take
+        RecordLoadThroughput(isCompressed, numPointsInWindow, timer.elapsed());
+    }
+    return error;
 }
 
-LasIOFilter::LasIOFilter()
-    : FileIOFilter({"LAS IO Filter",
-                    DEFAULT_PRIORITY, // priority
-                    QStringList{"las", "laz"},
-                    "laz",
-                    QStringList{"LAS file (*.las *.laz)"},
-                    QStringList{"LAS file (*.las *.laz)"},
-                    Import | Export})
+CC_FILE_ERROR LasIOFilter::MaterializeField(ccPointCloud &pointCloud, const QString &fieldName)
 {
+    return CreatePendingField(pointCloud, fieldName, false);
 }
 
-CC_FILE_ERROR LasIOFilter::loadFile(const QString &fileName, ccHObject &container, LoadParameters &parameters)
+CC_FILE_ERROR
+LasIOFilter::ReloadField(ccPointCloud &pointCloud, const QString &fileName, const QString &fieldName)
 {
-    laszip_POINTER laszipReader{};
+    if (!pointCloud.hasMetaData(LAS_METADATA_INFO_KEY))
+    {
+        ccLog::Warning("[LAS] The cloud was not loaded from a LAS file");
+        return CC_FERR_BAD_ENTITY_TYPE;
+    }
+    auto savedInfo = qvariant_cast<LasSavedInfo>(pointCloud.getMetaData(LAS_METADATA_INFO_KEY));
+
+    if (pointCloud.getScalarFieldIndexByName(qPrintable(fieldName)) != -1)
+    {
+        ccLog::Warning(QString("[LAS] The cloud already has a scalar field named '%1'").arg(fieldName));
+        return CC_FERR_BAD_ARGUMENT;
+    }
+
+    if (PendingFieldNames(pointCloud).contains(fieldName))
+    {
+        // No need to read the file again
+        return MaterializeField(pointCloud, fieldName);
+    }
+
+    laszip_POINTER laszipReader{nullptr};
     laszip_header *laszipHeader{nullptr};
+    laszip_point *laszipPoint{nullptr};
     laszip_BOOL isCompressed{false};
     laszip_CHAR *errorMsg{nullptr};
-
     if (laszip_create(&laszipReader))
     {
         return CC_FERR_THIRD_PARTY_LIB_FAILURE;
     }
 
-    if (laszip_open_reader(laszipReader, qPrintable(fileName), &isCompressed))
+    if (laszip_open_reader(laszipReader, qPrintable(fileName), &isCompressed) ||
+        laszip_get_header_pointer(laszipReader, &laszipHeader) ||
+        laszip_get_point_pointer(laszipReader, &laszipPoint))
     {
-        laszip_get_error(laszipHeader, &errorMsg);
+        laszip_get_error(laszipReader, &errorMsg);
         ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
+        CloseLaszipReader(laszipReader);
         return CC_FERR_THIRD_PARTY_LIB_FAILURE;
     }
 
-    if (laszip_get_header_pointer(laszipReader, &laszipHeader))
+    // If the cloud was split, merged, or edited its points no longer match the file's ones
+    const uint64_t pointCount = PointCount(*laszipHeader);
+    if (pointCount != savedInfo.numPoints || pointCount != pointCloud.size() ||
+        laszipHeader->point_data_format != savedInfo.pointFormat)
     {
-        laszip_get_error(laszipHeader, &errorMsg);
-        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
-        laszip_close_reader(laszipReader);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
-        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        ccLog::Warning(QString("[LAS] The cloud no longer has the points of '%1' in the same order")
+                           .arg(fileName));
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_BAD_ARGUMENT;
     }
 
-    laszip_U64 pointCount;
-    if (laszipHeader->version_minor == 4)
+    std::vector<LasScalarField> standardFields;
+    std::vector<LasExtraScalarField> extraFields;
+    for (const LasScalarField &field : LasScalarFieldForPointFormat(laszipHeader->point_data_format))
     {
-        pointCount = laszipHeader->extended_number_of_point_records;
+        if (fieldName == field.name())
+        {
+            standardFields.push_back(field);
+        }
     }
-    else
+    if (standardFields.empty())
     {
-        pointCount = laszipHeader->number_of_point_records;
+        const std::vector<LasExtraScalarField> fileExtraFields =
+            LasExtraScalarField::ParseExtraScalarFields(*laszipHeader);
+        for (const LasExtraScalarField &extraField : fileExtraFields)
+        {
+            if (fieldName == extraField.name)
+            {
+                extraFields.push_back(extraField);
+            }
+        }
     }
-
-    if (pointCount >= std::numeric_limits<unsigned int>::max())
+    if (!extraFields.empty() && extraFields.front().numElements() > 1 &&
+        pointCloud.getScalarFieldIndexByName(qPrintable(QString("%1 [0]").arg(fieldName))) != -1)
     {
-        // TODO
-        ccLog::Error("Files with more that %lu points are not supported", pointCount);
-        return CC_FERR_NOT_IMPLEMENTED;
+        ccLog::Warning(QString("[LAS] The cloud already has the scalar fields of '%1'").arg(fieldName));
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_BAD_ARGUMENT;
+    }
+    if (standardFields.empty() && extraFields.empty())
+    {
+        ccLog::Warning(QString("[LAS] '%1' has no field named '%2'").arg(fileName, fieldName));
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_BAD_ARGUMENT;
     }
 
-    auto pointCloud = std::make_unique<ccPointCloud>(QFileInfo(fileName).fileName());
-    if (!pointCloud->reserve(pointCount))
+    if (!ReopenWithSelectiveDecompression(laszipReader,
+                                          fileName,
+                                          isCompressed,
+                                          standardFields,
+                                          extraFields,
+                                          laszipHeader,
+                                          laszipPoint))
     {
-        laszip_close_reader(laszipReader);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
-        return CC_FERR_NOT_ENOUGH_MEMORY;
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
     }
 
-    std::vector<LasScalarField> availableScalarFields =
-        LasScalarFieldForPointFormat(laszipHeader->point_data_format);
+    QElapsedTimer timer;
+    timer.start();
 
-    std::vector<LasExtraScalarField> availableEXtraScalarFields =
-        LasExtraScalarField::ParseExtraScalarFields(*laszipHeader);
+    LasScalarFieldLoader loader(standardFields, extraFields, pointCloud);
 
-    LasOpenDialog dialog;
-    dialog.setInfo(laszipHeader->version_minor, laszipHeader->point_data_format, pointCount);
-    dialog.setAvailableScalarFields(availableScalarFields, availableEXtraScalarFields);
-    dialog.exec();
-    if (dialog.result() == QDialog::Rejected)
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Reloading LAS field");
+    progressDialog.setInfo(QString("Loading '%1'").arg(fieldName));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCloud.size());
+    constexpr unsigned int NumPointsPerProgressUpdate = 4096;
+    progressDialog.start();
+
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    for (unsigned int i{0}; i < pointCloud.size(); ++i)
     {
-        laszip_close_reader(laszipReader);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
-        return CC_FERR_CANCELED_BY_USER;
+        if (laszip_read_point(laszipReader))
+        {
+            laszip_get_error(laszipReader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            break;
+        }
+
+        error = loader.handleFields(pointCloud, i, *laszipPoint);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            break;
+        }
+
+        if ((i + 1) % NumPointsPerProgressUpdate == 0 && !normProgress.steps(NumPointsPerProgressUpdate))
+        {
+            error = CC_FERR_CANCELED_BY_USER;
+            break;
+        }
     }
+    CloseLaszipReader(laszipReader);
 
-    dialog.filterOutNotChecked(availableScalarFields, availableEXtraScalarFields);
+    error = AddLoadedField(pointCloud, loader, fieldName, error);
+    if (error == CC_FERR_NO_ERROR)
+    {
+        LogElapsedTime(timer);
+    }
+    return error;
+}
 
-    CCVector3d lasMins(laszipHeader->min_x, laszipHeader->min_y, laszipHeader->min_z);
+CC_FILE_ERROR LasIOFilter::LoadPlaceholderPoints(const LasPlaceholder &placeholder, ccPointCloud &pointCloud)
+{
+    const LasSavedInfo &savedInfo = placeholder.savedInfo();
+
+    QElapsedTimer timer;
+    timer.start();
+
+    laszip_POINTER laszipReader{nullptr};
+    laszip_header *laszipHeader{nullptr};
+    laszip_point *laszipPoint{nullptr};
+    laszip_BOOL isCompressed{false};
+    laszip_CHAR *errorMsg{nullptr};
+    if (laszip_create(&laszipReader))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    if (laszip_open_reader(laszipReader, qPrintable(placeholder.fileName()), &isCompressed) ||
+        laszip_get_header_pointer(laszipReader, &laszipHeader) ||
+        laszip_get_point_pointer(laszipReader, &laszipPoint))
+    {
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
 
-    laszip_F64 laszipCoordinates[3];
-    laszip_point *laszipPoint;
-    CCVector3 currentPoint{};
-    CCVector3d shift;
-    bool preserveGlobalShift{true};
+    const uint64_t pointCount = PointCount(*laszipHeader);
+    if (pointCount != savedInfo.numPoints || laszipHeader->point_data_format != savedInfo.pointFormat)
+    {
+        ccLog::Warning(
+            QString("[LAS] '%1' changed since the placeholder was created").arg(placeholder.fileName()));
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_BAD_ARGUMENT;
+    }
 
-    if (laszip_get_point_pointer(laszipReader, &laszipPoint))
+    if (!ReopenWithSelectiveDecompression(laszipReader,
+                                          placeholder.fileName(),
+                                          isCompressed,
+                                          placeholder.standardFields(),
+                                          placeholder.extraFields(),
+                                          laszipHeader,
+                                          laszipPoint))
     {
-        laszip_get_error(laszipHeader, &errorMsg);
+        laszip_get_error(laszipReader, &errorMsg);
         ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
-        laszip_close_reader(laszipReader);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
+        CloseLaszipReader(laszipReader);
         return CC_FERR_THIRD_PARTY_LIB_FAILURE;
     }
 
-    LasScalarFieldLoader loader(availableScalarFields, availableEXtraScalarFields, *pointCloud);
+    if (!pointCloud.resize(static_cast<unsigned int>(pointCount)))
+    {
+        CloseLaszipReader(laszipReader);
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+
+    std::vector<LasScalarField> standardFields = placeholder.standardFields();
+    std::vector<LasExtraScalarField> extraFields = placeholder.extraFields();
+    LasScalarFieldLoader loader(standardFields, extraFields, pointCloud);
+
     std::unique_ptr<LasWaveformLoader> waveformLoader{nullptr};
     if (HasWaveform(laszipHeader->point_data_format))
     {
-        waveformLoader = std::make_unique<LasWaveformLoader>(*laszipHeader, fileName, *pointCloud);
+        waveformLoader = std::make_unique<LasWaveformLoader>(*laszipHeader, placeholder.fileName());
+        if (!waveformLoader->prepare(pointCloud))
+        {
+            waveformLoader.reset();
+        }
     }
 
-    QElapsedTimer timer;
-    timer.start();
+    const CCVector3d shift = placeholder.shift();
+    const auto numPoints = static_cast<unsigned int>(pointCount);
 
     ccProgressDialog progressDialog(true);
     progressDialog.setMethodTitle("Loading LAS points");
-    progressDialog.setInfo("Loading points");
-    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCount);
-    unsigned int numStepsForUpdate = 1 * pointCount / 100;
+    progressDialog.setInfo(QString("Loading %1 points").arg(numPoints));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, numPoints);
+    unsigned int numStepsForUpdate = 1 * numPoints / 100;
     unsigned int lastProgressUpdate = 0;
     progressDialog.start();
 
+    const bool hasRGB = HasRGB(laszipHeader->point_data_format);
     CC_FILE_ERROR error{CC_FERR_NO_ERROR};
-    for (unsigned int i{0}; i < pointCount; ++i)
+    for (unsigned int i{0}; i < numPoints; ++i)
     {
         if (progressDialog.isCancelRequested())
         {
@@ -298,62 +2507,15 @@ CC_FILE_ERROR LasIOFilter::loadFile(const QString &fileName, ccHObject &containe
             break;
         }
 
-        if (laszip_get_coordinates(laszipReader, laszipCoordinates))
-        {
-            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
-            break;
-        }
-
-        if (i == 0)
-        {
-            CCVector3d firstPoint(laszipCoordinates[0], laszipCoordinates[1], laszipCoordinates[2]);
-            shift = GetGlobalShift(parameters, preserveGlobalShift, lasMins, firstPoint);
-
-            if (preserveGlobalShift)
-            {
-                pointCloud->setGlobalShift(shift);
-            }
-
-            if (shift.norm2() != 0.0)
-            {
-                ccLog::Warning("[LAS] Cloud has been re-centered! Translation: (%.2f ; %.2f ; %.2f)",
-                               shift.x,
-                               shift.y,
-                               shift.z);
-            }
-            pointCloud->setGlobalShift(shift);
-        }
-
-        currentPoint.x = static_cast<PointCoordinateType>(laszipCoordinates[0] + shift.x);
-        currentPoint.y = static_cast<PointCoordinateType>(laszipCoordinates[1] + shift.y);
-        currentPoint.z = static_cast<PointCoordinateType>(laszipCoordinates[2] + shift.z);
-
-        pointCloud->addPoint(currentPoint);
-
-        error = loader.handleScalarFields(*pointCloud, *laszipPoint);
-        if (error != CC_FERR_NO_ERROR)
-        {
-            break;
-        }
-
-        error = loader.handleExtraScalarFields(*pointCloud, *laszipPoint);
+        error = loader.loadPoint(laszipReader, *laszipPoint, shift, hasRGB, pointCloud, i);
         if (error != CC_FERR_NO_ERROR)
         {
             break;
         }
 
-        if (HasRGB(laszipHeader->point_data_format))
-        {
-            error = loader.handleRGBValue(*pointCloud, *laszipPoint);
-            if (error != CC_FERR_NO_ERROR)
-            {
-                break;
-            }
-        }
-
         if (waveformLoader)
         {
-            waveformLoader->loadWaveform(*pointCloud, *laszipPoint);
+            waveformLoader->loadWaveform(pointCloud, i, *laszipPoint);
         }
 
         if ((i - lastProgressUpdate) == numStepsForUpdate)
@@ -363,100 +2525,35 @@ CC_FILE_ERROR LasIOFilter::loadFile(const QString &fileName, ccHObject &containe
         }
     }
 
-    for (const LasScalarField &field : loader.standardFields())
+    if (error != CC_FERR_NO_ERROR)
     {
-        if (field.sf == nullptr)
-        {
-            // It may be null if all values were the same
-            continue;
-        }
-        field.sf->computeMinAndMax();
-        switch (field.id)
-        {
-        case LasScalarField::Intensity:
-            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::GREY));
-            field.sf->setSaturationStart(field.sf->getMin());
-            field.sf->setSaturationStop(field.sf->getMax());
-            field.sf->setMinDisplayed(field.sf->getMin());
-            field.sf->setMaxDisplayed(field.sf->getMax());
-        case LasScalarField::ReturnNumber:
-        case LasScalarField::NumberOfReturns:
-        case LasScalarField::ScanDirectionFlag:
-        case LasScalarField::EdgeOfFlightLine:
-        case LasScalarField::Classification:
-        case LasScalarField::SyntheticFlag:
-        case LasScalarField::KeypointFlag:
-        case LasScalarField::WithheldFlag:
-        case LasScalarField::ScanAngleRank:
-        case LasScalarField::UserData:
-        case LasScalarField::PointSourceId:
-        case LasScalarField::ExtendedScannerChannel:
-        case LasScalarField::OverlapFlag:
-        case LasScalarField::ExtendedClassification:
-        case LasScalarField::ExtendedReturnNumber:
-        case LasScalarField::ExtendedNumberOfReturns:
-        case LasScalarField::NearInfrared:
+        if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
         {
-            auto cMin = static_cast<int64_t>(field.sf->getMin());
-            auto cMax = static_cast<int64_t>(field.sf->getMax());
-            int64_t steps = std::min<int64_t>(cMax - cMin + 1, 256);
-            field.sf->setColorRampSteps(steps);
-            break;
-        }
-        case LasScalarField::GpsTime:
-            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::BGYR));
-            break;
-        case LasScalarField::ExtendedScanAngle:
-            field.sf->setColorScale(ccColorScalesManager::GetDefaultScale(ccColorScalesManager::BGYR));
-            break;
+            laszip_get_error(laszipReader, &errorMsg);
+            ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
         }
+        // The placeholder stays, so that loading can be tried again
+        CloseLaszipReader(laszipReader);
+        return error;
     }
+    CloseLaszipReader(laszipReader);
 
-    int idx = pointCloud->getScalarFieldIndexByName(LasNames::Intensity);
-    if (idx != -1)
-    {
-        pointCloud->setCurrentDisplayedScalarField(idx);
-    }
-    else if (pointCloud->getNumberOfScalarFields() > 0)
-    {
-        pointCloud->setCurrentDisplayedScalarField(0);
-    }
-    pointCloud->showColors(pointCloud->hasColors());
-    pointCloud->showSF(!pointCloud->hasColors() && pointCloud->hasDisplayedScalarField());
-
-    for (LasExtraScalarField &extraField : availableEXtraScalarFields)
-    {
-        extraField.resetScalarFieldsPointers();
-    }
-
-    LasSavedInfo info(*laszipHeader);
-    info.extraScalarFields = availableEXtraScalarFields;
-    pointCloud->setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(info));
-
-    container.addChild(pointCloud.release());
-
-    if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+    if (waveformLoader)
     {
-        laszip_get_error(laszipHeader, &errorMsg);
-        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
-        laszip_close_reader(laszipReader);
-        laszip_clean(laszipReader);
-        laszip_destroy(laszipReader);
+        waveformLoader->transferDataTo({&pointCloud});
     }
+    SetupLoadedScalarFields(pointCloud, loader.standardFields());
+    pointCloud.setName(QFileInfo(placeholder.fileName()).fileName());
+    pointCloud.setGlobalShift(shift);
+    pointCloud.setMetaData(LAS_METADATA_INFO_KEY, QVariant::fromValue(savedInfo));
 
-    timer.elapsed();
-    qint64 elapsed = timer.elapsed();
-    int32_t minutes = timer.elapsed() / (1000 * 60);
-    elapsed -= minutes * (1000 * 60);
-    int32_t seconds = elapsed / 1000;
-    elapsed -= seconds * 1000;
-    ccLog::Print(QString("[LAS] File loaded in %1m%2s%3ms").arg(minutes).arg(seconds).arg(elapsed));
-    return error;
+    LogElapsedTime(timer);
+    return CC_FERR_NO_ERROR;
 }
 
 bool LasIOFilter::canSave(CC_CLASS_ENUM type, bool &multiple, bool &exclusive) const
 {
-    multiple = false;
+    multiple = true;
     exclusive = true;
     return type == CC_TYPES::POINT_CLOUD;
 }
@@ -470,17 +2567,63 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject *entity,
         return CC_FERR_BAD_ARGUMENT;
     }
 
-    if (!entity->isA(CC_TYPES::POINT_CLOUD))
+    // When multiple clouds are saved, they are given as the children of the entity
+    std::vector<ccPointCloud *> pointClouds;
+    if (entity->isA(CC_TYPES::POINT_CLOUD))
+    {
+        pointClouds.push_back(static_cast<ccPointCloud *>(entity));
+    }
+    else
+    {
+        ccHObject::Container children;
+        entity->filterChildren(children, false, CC_TYPES::POINT_CLOUD, true);
+        for (ccHObject *child : children)
+        {
+            pointClouds.push_back(static_cast<ccPointCloud *>(child));
+        }
+    }
+
+    if (pointClouds.empty())
     {
         return CC_FERR_BAD_ENTITY_TYPE;
     }
-    auto *pointCloud = static_cast<ccPointCloud *>(entity);
+
+    // The fields in compact storage or created on demand are saved through scalar fields like the others,
+    // these only exist while saving so the clouds keep the memory savings
+    TemporaryPendingFields temporaryFields;
+    for (ccPointCloud *cloud : pointClouds)
+    {
+        const CC_FILE_ERROR error = temporaryFields.create(*cloud);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            return error;
+        }
+    }
+    // The first cloud is the one used to set up the dialog and the header
+    ccPointCloud *pointCloud = pointClouds.front();
+
+    // Bounding box of all the clouds, in global coordinates
+    CCVector3d bbMinGlobal(std::numeric_limits<double>::max(),
+                           std::numeric_limits<double>::max(),
+                           std::numeric_limits<double>::max());
+    CCVector3d bbMaxGlobal = -bbMinGlobal;
+    for (ccPointCloud *cloud : pointClouds)
+    {
+        CCVector3 bbMax;
+        CCVector3 bbMin;
+        cloud->getBoundingBox(bbMin, bbMax);
+        const CCVector3d cloudMin = cloud->toGlobal3d(bbMin);
+        const CCVector3d cloudMax = cloud->toGlobal3d(bbMax);
+        bbMinGlobal = CCVector3d(std::min(bbMinGlobal.x, cloudMin.x),
+                                 std::min(bbMinGlobal.y, cloudMin.y),
+                                 std::min(bbMinGlobal.z, cloudMin.z));
+        bbMaxGlobal = CCVector3d(std::max(bbMaxGlobal.x, cloudMax.x),
+                                 std::max(bbMaxGlobal.y, cloudMax.y),
+                                 std::max(bbMaxGlobal.z, cloudMax.z));
+    }
 
     // optimal scale (for accuracy) --> 1e-9 because the maximum integer is roughly +/-2e+9
-    CCVector3 bbMax;
-    CCVector3 bbMin;
-    pointCloud->getBoundingBox(bbMin, bbMax);
-    CCVector3d diag = bbMax - bbMin;
+    CCVector3d diag = bbMaxGlobal - bbMinGlobal;
     CCVector3d optimalScale(1.0e-9 * std::max<double>(diag.x, CCCoreLib::ZERO_TOLERANCE_D),
                             1.0e-9 * std::max<double>(diag.y, CCCoreLib::ZERO_TOLERANCE_D),
                             1.0e-9 * std::max<double>(diag.z, CCCoreLib::ZERO_TOLERANCE_D));
@@ -499,10 +2642,35 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject *entity,
         saveDialog.setSavedScale(CCVector3d(savedInfo.xScale, savedInfo.yScale, savedInfo.zScale));
     }
 
+    // The extra bytes schema is the union (by name) of the ones of all the clouds
+    for (size_t i{1}; i < pointClouds.size(); ++i)
+    {
+        if (!pointClouds[i]->hasMetaData(LAS_METADATA_INFO_KEY))
+        {
+            continue;
+        }
+        const auto otherInfo =
+            qvariant_cast<LasSavedInfo>(pointClouds[i]->getMetaData(LAS_METADATA_INFO_KEY));
+        for (const LasExtraScalarField &extraField : otherInfo.extraScalarFields)
+        {
+            if (std::none_of(savedInfo.extraScalarFields.begin(),
+                             savedInfo.extraScalarFields.end(),
+                             [&extraField](const LasExtraScalarField &other)
+                             { return strcmp(other.name, extraField.name) == 0; }))
+            {
+                savedInfo.extraScalarFields.push_back(extraField);
+            }
+        }
+    }
+
     saveDialog.setOptimalScale(optimalScale);
     saveDialog.setVersionAndPointFormat(QString("1.%1").arg(QString::number(savedInfo.versionMinor)),
                                         savedInfo.pointFormat);
     saveDialog.setExtraScalarFields(savedInfo.extraScalarFields);
+    saveDialog.setHasVisibilityTable(std::any_of(pointClouds.begin(),
+                                                 pointClouds.end(),
+                                                 [](const ccPointCloud *cloud)
+                                                 { return cloud->isVisibilityTableInstantiated(); }));
 
     saveDialog.exec();
     if (saveDialog.result() == QDialog::Rejected)
@@ -510,155 +2678,280 @@ CC_FILE_ERROR LasIOFilter::saveToFile(ccHObject *entity,
         return CC_FERR_CANCELED_BY_USER;
     }
 
-    laszip_header laszipHeader = InitLaszipHeader(saveDialog, savedInfo, *pointCloud);
-
-    std::vector<LasScalarField> fieldsToSave = saveDialog.fieldsToSave();
-    LasScalarFieldSaver fieldSaver(fieldsToSave, savedInfo.extraScalarFields);
-    std::unique_ptr<LasWaveformSaver> waveformSaver{nullptr};
-    if (saveDialog.shouldSaveWaveform())
+    // Multiple clouds are saved relatively to the minimum of their bounding box,
+    // the scale may come from the first cloud and be too small for all of them
+    const CCVector3d chosenScale = saveDialog.chosenScale();
+    const double int32Max = std::numeric_limits<laszip_I32>::max();
+    if (pointClouds.size() > 1 && (diag.x / chosenScale.x > int32Max || diag.y / chosenScale.y > int32Max ||
+                                   diag.z / chosenScale.z > int32Max))
     {
-        Q_ASSERT(HasWaveform(laszipHeader.point_data_format) && pointCloud->hasFWF());
-        waveformSaver = std::make_unique<LasWaveformSaver>(*pointCloud);
+        ccLog::Error(QString("[LAS] The chosen scale is too small for the extent of the clouds, "
+                             "the scale should be at least (%1, %2, %3)")
+                         .arg(optimalScale.x)
+                         .arg(optimalScale.y)
+                         .arg(optimalScale.z));
+        return CC_FERR_BAD_ARGUMENT;
     }
 
-    laszip_POINTER laszipWriter{nullptr};
-    laszip_CHAR *errorMsg{nullptr};
-
-    if (laszip_create(&laszipWriter))
-    {
-        ccLog::Warning("[LAS] laszip failed to create the writer");
-        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
-    }
+    laszip_header laszipHeader = InitLaszipHeader(saveDialog, savedInfo, *pointCloud);
 
-    if (laszip_set_header(laszipWriter, &laszipHeader))
+    bool saveWaveform = saveDialog.shouldSaveWaveform();
+    if (pointClouds.size() > 1)
     {
-        laszip_get_error(laszipWriter, &errorMsg);
-        ccLog::Warning("[LAS] laszip error :'%s'", errorMsg);
-        laszip_destroy(laszipWriter);
-        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
-    }
+        // The clouds may not share the same global shift
+        laszipHeader.x_offset = bbMinGlobal.x;
+        laszipHeader.y_offset = bbMinGlobal.y;
+        laszipHeader.z_offset = bbMinGlobal.z;
 
-    if (laszip_open_writer(laszipWriter, qPrintable(filename), filename.endsWith("laz")))
-    {
-        laszip_get_error(laszipWriter, &errorMsg);
-        ccLog::Warning("[LAS] laszip error :'%s'", errorMsg);
-        laszip_destroy(laszipWriter);
-        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        if (HasWaveform(laszipHeader.point_data_format) && saveWaveform)
+        {
+            ccLog::Warning("[LAS] Waveforms are not saved when saving multiple clouds in one file");
+            saveWaveform = false;
+        }
     }
-
-    laszip_point laszipPoint{};
-    int totalExtraByteSize =
-        laszipHeader.point_data_record_length - PointFormatSize(laszipHeader.point_data_format);
-    if (totalExtraByteSize > 0)
+    saveWaveform = saveWaveform && HasWaveform(laszipHeader.point_data_format) && pointCloud->hasFWF();
+    const bool saveWaveformInternally = saveWaveform && saveDialog.shouldSaveWaveformInternally();
+    const bool layeredCompression = saveDialog.shouldUseLayeredCompression();
+    if (!saveWaveform)
     {
-        laszipPoint.num_extra_bytes = totalExtraByteSize;
-        laszipPoint.extra_bytes = new laszip_U8[totalExtraByteSize];
+        // No waveform data will be written
+        laszipHeader.global_encoding &= ~0b0000'0110;
     }
 
-    ccProgressDialog progressDialog(true);
-    progressDialog.setMethodTitle("Saving LAS points");
-    progressDialog.setInfo("Saving points");
-    CCCoreLib::NormalizedProgress normProgress(&progressDialog, pointCloud->size());
-    unsigned int numStepsForUpdate = 1 * pointCloud->size() / 100;
-    unsigned int lastProgressUpdate = 0;
-    progressDialog.start();
-
-    CC_FILE_ERROR error = CC_FERR_NO_ERROR;
-    for (unsigned int i{0}; i < pointCloud->size(); ++i)
+    // Bind the fields chosen for the first cloud to the scalar fields of each cloud (by name)
+    const std::vector<LasScalarField> fieldsToSave = saveDialog.fieldsToSave();
+    std::vector<LasWriteSource> sources(pointClouds.size());
+    for (size_t i{0}; i < pointClouds.size(); ++i)
     {
-        fieldSaver.handleScalarFields(i, laszipPoint);
-        fieldSaver.handleExtraFields(i, laszipPoint);
+        ccPointCloud *cloud = pointClouds[i];
+        LasWriteSource &source = sources[i];
+        source.cloud = cloud;
+        source.saveRGB = saveDialog.shouldSaveRGB() && cloud->hasColors();
+        source.saveWaveform = saveWaveform && cloud->hasFWF();
 
-        if (waveformSaver)
+        for (LasScalarField field : fieldsToSave)
         {
-            waveformSaver->handlePoint(i, laszipPoint);
+            const int sfIdx = cloud->getScalarFieldIndexByName(field.sf->getName());
+            if (sfIdx >= 0)
+            {
+                field.sf = static_cast<ccScalarField *>(cloud->getScalarField(sfIdx));
+                source.fieldsToSave.push_back(field);
+            }
         }
 
-        if (saveDialog.shouldSaveRGB())
-        {
-            Q_ASSERT(HasRGB(laszipHeader.point_data_format) && pointCloud->hasColors());
-            const ccColor::Rgba &color = pointCloud->getPointColor(i);
-            laszipPoint.rgb[0] = static_cast<laszip_U16>(color.r) << 8;
-            laszipPoint.rgb[1] = static_cast<laszip_U16>(color.g) << 8;
-            laszipPoint.rgb[2] = static_cast<laszip_U16>(color.b) << 8;
-        }
+        source.extraFields = savedInfo.extraScalarFields;
+        LasExtraScalarField::MatchExtraBytesToScalarFields(source.extraFields, *cloud);
+        source.extraFields.erase(std::remove_if(source.extraFields.begin(),
+                                                source.extraFields.end(),
+                                                [](const LasExtraScalarField &extraField)
+                                                {
+                                                    return std::any_of(extraField.scalarFields,
+                                                                       extraField.scalarFields +
+                                                                           extraField.numElements(),
+                                                                       [](const ccScalarField *sf)
+                                                                       { return sf == nullptr; });
+                                                }),
+                                 source.extraFields.end());
+    }
 
-        const CCVector3 *point = pointCloud->getPoint(i);
-        if (pointCloud->isShifted())
+    if (saveDialog.shouldSaveVisiblePointsOnly())
+    {
+        // Only the indices of the visible points are kept, the cloud is not copied
+        try
         {
-            laszipPoint.X = static_cast<laszip_I32>(point->x / laszipHeader.x_scale_factor);
-            laszipPoint.Y = static_cast<laszip_I32>(point->y / laszipHeader.y_scale_factor);
-            laszipPoint.Z = static_cast<laszip_I32>(point->z / laszipHeader.z_scale_factor);
+            for (LasWriteSource &source : sources)
+            {
+                if (!source.cloud->isVisibilityTableInstantiated())
+                {
+                    continue;
+                }
+                const ccGenericPointCloud::VisibilityTableType &visibility =
+                    source.cloud->getTheVisibilityArray();
+                for (unsigned int i{0}; i < source.cloud->size(); ++i)
+                {
+                    if (visibility[i] == CCCoreLib::POINT_VISIBLE)
+                    {
+                        source.indices.push_back(i);
+                    }
+                }
+
+                if (source.indices.size() == source.cloud->size())
+                {
+                    // All the points are visible
+                    source.indices.clear();
+                }
+                else if (source.indices.empty())
+                {
+                    source.cloud = nullptr;
+                }
+            }
         }
-        else
+        catch (const std::bad_alloc &)
         {
-            CCVector3d globalPoint = pointCloud->toGlobal3d<PointCoordinateType>(*point);
-            laszipPoint.X = static_cast<laszip_I32>((globalPoint.x - laszipHeader.x_offset) /
-                                                    laszipHeader.x_scale_factor);
-            laszipPoint.Y = static_cast<laszip_I32>((globalPoint.y - laszipHeader.y_offset) /
-                                                    laszipHeader.y_scale_factor);
-            laszipPoint.Z = static_cast<laszip_I32>((globalPoint.z - laszipHeader.z_offset) /
-                                                    laszipHeader.z_scale_factor);
+            return CC_FERR_NOT_ENOUGH_MEMORY;
         }
 
-        if (laszip_set_point(laszipWriter, &laszipPoint))
+        sources.erase(std::remove_if(sources.begin(),
+                                     sources.end(),
+                                     [](const LasWriteSource &source) { return source.cloud == nullptr; }),
+                      sources.end());
+        if (sources.empty())
         {
-            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
-            break;
+            ccLog::Warning("[LAS] No visible points to save");
+            return CC_FERR_NO_SAVE;
         }
+    }
 
-        if (laszip_write_point(laszipWriter))
+    // The files to write, with the points that go in each of them
+    std::vector<std::pair<QString, std::vector<LasWriteSource>>> outputs;
+    const QString splitFieldName = saveDialog.splitFieldName();
+    if (splitFieldName.isEmpty())
+    {
+        outputs.emplace_back(filename, std::move(sources));
+    }
+    else
+    {
+        // Single pass over the clouds to find which points go in which file
+        std::map<unsigned int, std::vector<LasWriteSource>> sourcesOfValue;
+        try
         {
-            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
-            break;
+            for (const LasWriteSource &source : sources)
+            {
+                auto splitField = std::find_if(source.fieldsToSave.begin(),
+                                               source.fieldsToSave.end(),
+                                               [&splitFieldName](const LasScalarField &field)
+                                               { return splitFieldName == field.name(); });
+                if (splitField == source.fieldsToSave.end() || splitField->sf == nullptr)
+                {
+                    ccLog::Error(QString("[LAS] '%1' has no scalar field for '%2', cannot split by it")
+                                     .arg(source.cloud->getName(), splitFieldName));
+                    return CC_FERR_BAD_ARGUMENT;
+                }
+
+                std::map<unsigned int, std::vector<unsigned int>> indicesOfValue;
+                for (unsigned int j{0}; j < source.numPoints(); ++j)
+                {
+                    const unsigned int i = source.indices.empty() ? j : source.indices[j];
+                    ScalarType value = splitField->sf->getValue(i);
+                    value = std::max(splitField->range.min, value);
+                    value = std::min(splitField->range.max, value);
+                    indicesOfValue[static_cast<unsigned int>(value)].push_back(i);
+                }
+
+                for (auto &valueAndIndices : indicesOfValue)
+                {
+                    LasWriteSource subset = source;
+                    subset.indices = std::move(valueAndIndices.second);
+                    sourcesOfValue[valueAndIndices.first].push_back(std::move(subset));
+                }
+            }
         }
-
-        if (laszip_update_inventory(laszipWriter))
+        catch (const std::bad_alloc &)
         {
-            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
-            break;
+            return CC_FERR_NOT_ENOUGH_MEMORY;
         }
 
-        if ((i - lastProgressUpdate) == numStepsForUpdate)
+        QFileInfo info(filename);
+        const QString fieldTag = QString(splitFieldName).remove(' ');
+        for (auto &valueAndSources : sourcesOfValue)
         {
-            normProgress.steps(i - lastProgressUpdate);
-            lastProgressUpdate += (i - lastProgressUpdate);
-            QApplication::processEvents();
+            const QString splitFilename = QString("%1/%2_%3_%4.%5")
+                                              .arg(info.path(), info.completeBaseName(), fieldTag)
+                                              .arg(valueAndSources.first)
+                                              .arg(info.suffix());
+            outputs.emplace_back(splitFilename, std::move(valueAndSources.second));
         }
+        ccLog::Print(QString("[LAS] Splitting the points into %1 files by '%2'")
+                         .arg(outputs.size())
+                         .arg(splitFieldName));
     }
 
-    if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+    uint64_t totalNumPoints{0};
+    for (const auto &output : outputs)
     {
-        laszip_get_error(laszipWriter, &errorMsg);
-        ccLog::Warning("[LAS] laszip error :'%s'", errorMsg);
+        for (const LasWriteSource &source : output.second)
+        {
+            totalNumPoints += source.numPoints();
+        }
     }
 
-    if (HasWaveform(laszipHeader.point_data_format) && pointCloud->hasFWF())
-    {
-        const ccPointCloud::SharedFWFDataContainer &fwfData = pointCloud->fwfData();
-        QFileInfo info(filename);
-        QString wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.baseName());
-        QFile fwfFile(wdpFilename);
+    ccProgressDialog progressDialog(true);
+    progressDialog.setMethodTitle("Saving LAS points");
+    progressDialog.setInfo(outputs.size() == 1 ? QString("Saving points")
+                                               : QString("Saving points into %1 files").arg(outputs.size()));
+    // The progress saturates if there are more points than what it can count
+    const uint64_t maxProgressSteps = std::numeric_limits<unsigned int>::max();
+    const auto numProgressSteps = static_cast<unsigned int>(std::min(totalNumPoints, maxProgressSteps));
+    CCCoreLib::NormalizedProgress normProgress(&progressDialog, numProgressSteps);
+    progressDialog.start();
 
-        if (!fwfFile.open(QIODevice::WriteOnly))
-        {
-            ccLog::Error("[LAS] Failed to write waveform data");
-            error = CC_FERR_WRITING;
-        }
-        else
+    // Each file has its own writer, so they are written concurrently
+    std::vector<CC_FILE_ERROR> errors(outputs.size(), CC_FERR_NO_ERROR);
+    std::atomic<unsigned int> numWritten{0};
+    std::atomic<bool> cancelRequested{false};
+    std::atomic<size_t> nextOutput{0};
+    std::atomic<size_t> numFinishedThreads{0};
+    const auto worker = [&]()
+    {
+        for (size_t i = nextOutput++; i < outputs.size(); i = nextOutput++)
         {
+            // Only the waveform data referenced by the points of the file is written
+            WaveformDataRanges waveformDataRanges;
+            try
             {
-                EvlrHeader header = EvlrHeader::Waveform();
-                QDataStream stream(&fwfFile);
-                stream << header;
+                if (saveWaveform)
+                {
+                    waveformDataRanges = CollectWaveformDataRanges(outputs[i].second);
+                }
+            }
+            catch (const std::bad_alloc &)
+            {
+                errors[i] = CC_FERR_NOT_ENOUGH_MEMORY;
+                cancelRequested = true;
+                continue;
+            }
+
+            errors[i] = WriteLasFile(outputs[i].first,
+                                     laszipHeader,
+                                     outputs[i].second,
+                                     saveWaveform ? &waveformDataRanges : nullptr,
+                                     layeredCompression,
+                                     numWritten,
+                                     cancelRequested);
+            if (errors[i] == CC_FERR_NO_ERROR && saveWaveform)
+            {
+                errors[i] =
+                    saveWaveformInternally
+                        ? AppendWaveformDataEvlr(
+                              outputs[i].first, laszipHeader, *pointCloud, waveformDataRanges)
+                        : WriteWaveformDataFile(outputs[i].first, *pointCloud, waveformDataRanges);
+            }
+            if (errors[i] != CC_FERR_NO_ERROR)
+            {
+                cancelRequested = true;
             }
-            fwfFile.write(reinterpret_cast<const char *>(fwfData->data()), fwfData->size());
-            ccLog::Print(QString("[LAS] Successfully saved FWF in external file '$1'").arg(wdpFilename));
         }
+        ++numFinishedThreads;
+    };
+
+    const size_t numThreads =
+        std::min<size_t>(outputs.size(), std::max<unsigned int>(1, std::thread::hardware_concurrency()));
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (size_t i{0}; i < numThreads; ++i)
+    {
+        threads.emplace_back(worker);
     }
+    WaitForWorkers(threads, numFinishedThreads, numWritten, cancelRequested, progressDialog, normProgress);
 
-    laszip_close_writer(laszipWriter);
-    laszip_clean(laszipWriter);
-    laszip_destroy(laszipWriter);
+    CC_FILE_ERROR error = CC_FERR_NO_ERROR;
+    for (CC_FILE_ERROR outputError : errors)
+    {
+        if (outputError != CC_FERR_NO_ERROR &&
+            (error == CC_FERR_NO_ERROR || error == CC_FERR_CANCELED_BY_USER))
+        {
+            error = outputError;
+        }
+    }
     return error;
 }
@@ -0,0 +1,102 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasMemoryEstimate.h"
+#include "LasCompactField.h"
+#include "LasPointRecords.h"
+
+#include <ccColorTypes.h>
+#include <ccWaveform.h>
+
+#include <QSettings>
+
+static QString ThroughputKey(bool isCompressed)
+{
+    return isCompressed ? "LAS-IO/compressedPointsPerSecond" : "LAS-IO/uncompressedPointsPerSecond";
+}
+
+double EstimatedBytesPerPoint(const laszip_header &header,
+                              const std::vector<LasScalarField> &fields,
+                              const std::vector<LasExtraScalarField> &extraFields,
+                              const LasStorageOptions &options)
+{
+    double bytes = 3 * sizeof(PointCoordinateType);
+    if (HasRGB(header.point_data_format))
+    {
+        // Colors are stored as RGBA
+        bytes += 4 * sizeof(ColorCompType);
+    }
+    if (options.waveforms && HasWaveform(header.point_data_format))
+    {
+        bytes += sizeof(ccWaveform);
+    }
+
+    bool hasDeferredFields{false};
+    for (const LasScalarField &field : fields)
+    {
+        if (options.compactStorage && LasCompactField::IsSupported(field.id))
+        {
+            bytes += LasCompactField::BytesPerValue(field.id);
+        }
+        else if (options.fieldsOnDemand)
+        {
+            hasDeferredFields = true;
+        }
+        else
+        {
+            bytes += sizeof(ScalarType);
+        }
+    }
+    for (const LasExtraScalarField &extraField : extraFields)
+    {
+        if (options.fieldsOnDemand)
+        {
+            hasDeferredFields = true;
+        }
+        else
+        {
+            bytes += extraField.numElements() * sizeof(ScalarType);
+        }
+    }
+
+    if (hasDeferredFields)
+    {
+        bytes += LasPointRecords::RecordSize(header);
+    }
+    return bytes;
+}
+
+double MeasuredLoadThroughput(bool isCompressed)
+{
+    return QSettings().value(ThroughputKey(isCompressed), 0.0).toDouble();
+}
+
+void RecordLoadThroughput(bool isCompressed, uint64_t numPoints, qint64 elapsedMs)
+{
+    if (numPoints == 0 || elapsedMs <= 0)
+    {
+        return;
+    }
+    double throughput = static_cast<double>(numPoints) * 1000.0 / static_cast<double>(elapsedMs);
+
+    // Smooths out loads slowed down (or sped up) by the file cache or by other programs
+    const double previousThroughput = MeasuredLoadThroughput(isCompressed);
+    if (previousThroughput > 0.0)
+    {
+        throughput = 0.7 * previousThroughput + 0.3 * throughput;
+    }
+    QSettings().setValue(ThroughputKey(isCompressed), throughput);
+}
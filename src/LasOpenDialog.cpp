@@ -16,6 +16,15 @@
 //##########################################################################
 
 #include "LasOpenDialog.h"
+#include "LasMemoryEstimate.h"
+#include "LasPreview.h"
+
+#include <QApplication>
+#include <QFileDialog>
+
+#include <algorithm>
+#include <cmath>
+#include <initializer_list>
 
 static QListWidgetItem *CreateItem(const char *name)
 {
@@ -57,6 +66,18 @@ bool IsCheckedIn(const QString &name, const QListWidget &list)
     return false;
 }
 
+bool IsUncheckedIn(const QString &name, const QListWidget &list)
+{
+    for (int i = 0; i < list.count(); ++i)
+    {
+        if (list.item(i)->text() == name)
+        {
+            return list.item(i)->checkState() != Qt::Checked;
+        }
+    }
+    return false;
+}
+
 // TODO use std::remove_if
 template <typename T, typename Pred> void RemoveFalse(std::vector<T> &vec, Pred predicate)
 {
@@ -75,6 +96,41 @@ LasOpenDialog::LasOpenDialog(QWidget *parent) : QDialog(parent)
     connect(applyButton, &QPushButton::clicked, this, &QDialog::accept);
     connect(applyAllButton, &QPushButton::clicked, this, &QDialog::accept);
     connect(cancelButton, &QPushButton::clicked, this, &QDialog::reject);
+    connect(addMergeFilesButton, &QPushButton::clicked, this, &LasOpenDialog::addFilesToMerge);
+    connect(removeMergeFilesButton, &QPushButton::clicked, this, &LasOpenDialog::removeSelectedFilesToMerge);
+    connect(availableScalarFields, &QListWidget::itemChanged, this, &LasOpenDialog::updateEstimates);
+    connect(availableExtraScalarFields, &QListWidget::itemChanged, this, &LasOpenDialog::updateEstimates);
+    connect(compactStorageCheckBox, &QCheckBox::toggled, this, &LasOpenDialog::updateEstimates);
+    connect(onDemandFieldsCheckBox, &QCheckBox::toggled, this, &LasOpenDialog::updateEstimates);
+    connect(previewButton, &QPushButton::clicked, this, &LasOpenDialog::showPreview);
+    connect(pointWindowCheckBox, &QCheckBox::toggled, firstPointSpinBox, &QWidget::setEnabled);
+    connect(pointWindowCheckBox, &QCheckBox::toggled, lastPointSpinBox, &QWidget::setEnabled);
+    connect(pointWindowCheckBox, &QCheckBox::toggled, this, &LasOpenDialog::updateEstimates);
+    connect(firstPointSpinBox,
+            qOverload<double>(&QDoubleSpinBox::valueChanged),
+            this,
+            [this](double first)
+            {
+                lastPointSpinBox->setMinimum(first + 1);
+                updateEstimates();
+            });
+    connect(lastPointSpinBox,
+            qOverload<double>(&QDoubleSpinBox::valueChanged),
+            this,
+            &LasOpenDialog::updateEstimates);
+    connect(memoryBudgetSpinBox,
+            qOverload<int>(&QSpinBox::valueChanged),
+            this,
+            &LasOpenDialog::updateEstimates);
+    connect(mergeGroupBox, &QGroupBox::toggled, this, &LasOpenDialog::updateSingleCloudOptions);
+    connect(splitFieldComboBox,
+            qOverload<int>(&QComboBox::currentIndexChanged),
+            this,
+            &LasOpenDialog::updateSingleCloudOptions);
+    previewButton->setEnabled(false);
+
+    memoryEstimateLabelValue->setText("Unknown");
+    loadTimeEstimateLabelValue->setText("Unknown");
 }
 
 void LasOpenDialog::setInfo(int versionMinor, int pointFormatId, int64_t numPoints)
@@ -82,14 +138,35 @@ void LasOpenDialog::setInfo(int versionMinor, int pointFormatId, int64_t numPoin
     versionLabelValue->setText(QString("1.%1").arg(QString::number(versionMinor)));
     pointFormatLabelValue->setText(QString::number(pointFormatId));
     numPointsLabelValue->setText(PrettyFormatNumber(numPoints));
+
+    firstPointSpinBox->setRange(0, static_cast<double>(std::max<int64_t>(numPoints - 1, 0)));
+    lastPointSpinBox->setRange(1, static_cast<double>(numPoints));
+    lastPointSpinBox->setValue(static_cast<double>(numPoints));
 }
 
 void LasOpenDialog::setAvailableScalarFields(const std::vector<LasScalarField> &scalarFields,
                                              const std::vector<LasExtraScalarField> &extraScalarFields)
 {
+    m_scalarFields = scalarFields;
+    m_extraScalarFields = extraScalarFields;
+
+    splitFieldComboBox->clear();
+    splitFieldComboBox->addItem("None");
     for (const LasScalarField &lasScalarField : scalarFields)
     {
         availableScalarFields->addItem(CreateItem(lasScalarField.name()));
+
+        switch (lasScalarField.id)
+        {
+        case LasScalarField::Classification:
+        case LasScalarField::ExtendedClassification:
+        case LasScalarField::PointSourceId:
+        case LasScalarField::ExtendedScannerChannel:
+            splitFieldComboBox->addItem(lasScalarField.name());
+            break;
+        default:
+            break;
+        }
     }
 
     if (!extraScalarFields.empty())
@@ -110,6 +187,136 @@ void LasOpenDialog::setAvailableScalarFields(const std::vector<LasScalarField> &
     }
 }
 
+void LasOpenDialog::setEstimateInfo(const laszip_header &header, bool isCompressed)
+{
+    m_header.point_data_format = header.point_data_format;
+    m_header.point_data_record_length = header.point_data_record_length;
+    m_numPoints = PointCount(header);
+    m_isCompressed = isCompressed;
+    updateEstimates();
+}
+
+void LasOpenDialog::updateEstimates()
+{
+    if (m_numPoints == 0)
+    {
+        return;
+    }
+
+    std::vector<LasScalarField> scalarFields = m_scalarFields;
+    std::vector<LasExtraScalarField> extraScalarFields = m_extraScalarFields;
+    filterOutNotChecked(scalarFields, extraScalarFields);
+
+    LasStorageOptions options;
+    options.compactStorage = shouldUseCompactStorage();
+    options.fieldsOnDemand = shouldCreateFieldsOnDemand();
+    options.waveforms = HasWaveform(m_header.point_data_format);
+    const uint64_t numPointsToLoad = lastPointToLoad() - firstPointToLoad();
+    const double numBytes = EstimatedBytesPerPoint(m_header, scalarFields, extraScalarFields, options) *
+                            static_cast<double>(numPointsToLoad);
+    QString memoryEstimate = QString("%1 MB").arg(numBytes / (1024.0 * 1024.0), 0, 'f', 0);
+    const uint64_t budget = memoryBudget();
+    if (budget != 0 && numBytes > budget && !options.compactStorage && !options.fieldsOnDemand)
+    {
+        // The budget does not enable compact storage by itself, as it hides the fields
+        options.compactStorage = true;
+        const double compactNumBytes =
+            EstimatedBytesPerPoint(m_header, scalarFields, extraScalarFields, options) *
+            static_cast<double>(numPointsToLoad);
+        if (compactNumBytes < numBytes)
+        {
+            memoryEstimate += QString(" (over the budget, %1 MB with compact storage)")
+                                  .arg(compactNumBytes / (1024.0 * 1024.0), 0, 'f', 0);
+        }
+    }
+    memoryEstimateLabelValue->setText(memoryEstimate);
+
+    const double throughput = MeasuredLoadThroughput(m_isCompressed);
+    if (throughput <= 0.0)
+    {
+        loadTimeEstimateLabelValue->setText("Unknown");
+        return;
+    }
+    const auto seconds = static_cast<int64_t>(std::ceil(static_cast<double>(numPointsToLoad) / throughput));
+    if (seconds < 60)
+    {
+        loadTimeEstimateLabelValue->setText(QString("%1 s").arg(seconds));
+    }
+    else
+    {
+        loadTimeEstimateLabelValue->setText(QString("%1 min %2 s").arg(seconds / 60).arg(seconds % 60));
+    }
+}
+
+void LasOpenDialog::setPreviewFileName(const QString &fileName)
+{
+    m_previewFileName = fileName;
+    previewButton->setEnabled(!fileName.isEmpty());
+}
+
+void LasOpenDialog::showPreview()
+{
+    LasPreview preview;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const CC_FILE_ERROR error = LasPreview::Compute(m_previewFileName, preview);
+    QApplication::restoreOverrideCursor();
+    if (error != CC_FERR_NO_ERROR)
+    {
+        previewLabel->setText("Failed to read a preview of the file");
+        return;
+    }
+
+    QStringList lines;
+    lines << QString("Preview of %1 points").arg(preview.numSampledPoints);
+    if (preview.hasRGB)
+    {
+        lines << QString("Colors: %1 bits").arg(preview.isRGB16Bits ? 16 : 8);
+    }
+
+    std::vector<std::pair<int, unsigned int>> classifications(preview.classificationCounts.begin(),
+                                                              preview.classificationCounts.end());
+    std::sort(classifications.begin(),
+              classifications.end(),
+              [](const auto &lhs, const auto &rhs) { return lhs.second > rhs.second; });
+    QStringList classificationShares;
+    for (const auto &classification : classifications)
+    {
+        classificationShares << QString("%1 (%2%)")
+                                    .arg(classification.first)
+                                    .arg(100.0 * classification.second / preview.numSampledPoints, 0, 'f', 0);
+    }
+    lines << QString("Classifications: %1").arg(classificationShares.join(", "));
+
+    QStringList allZeroFields;
+    for (const LasPreview::FieldRange &range : preview.fieldRanges)
+    {
+        QList<QListWidgetItem *> items = availableScalarFields->findItems(range.name, Qt::MatchExactly);
+        items += availableExtraScalarFields->findItems(range.name, Qt::MatchExactly);
+        for (QListWidgetItem *item : items)
+        {
+            if (range.isAllZero())
+            {
+                item->setToolTip("All the sampled values are 0");
+                item->setForeground(Qt::gray);
+            }
+            else
+            {
+                item->setToolTip(QString("Sampled values: %1 to %2").arg(range.min).arg(range.max));
+            }
+        }
+        if (range.isAllZero())
+        {
+            allZeroFields << range.name;
+        }
+    }
+    if (!allZeroFields.isEmpty())
+    {
+        lines << QString("All zero: %1").arg(allZeroFields.join(", "));
+    }
+
+    previewLabel->setText(lines.join("\n"));
+}
+
 void LasOpenDialog::filterOutNotChecked(std::vector<LasScalarField> &scalarFields,
                                         std::vector<LasExtraScalarField> &extraScalarFields)
 {
@@ -127,4 +334,115 @@ bool LasOpenDialog::isChecked(const LasExtraScalarField &lasExtraScalarField) co
 bool LasOpenDialog::isChecked(const LasScalarField &lasScalarField) const
 {
     return IsCheckedIn(lasScalarField.name(), *availableScalarFields);
-}
\ No newline at end of file
+}
+
+bool LasOpenDialog::isUnchecked(const char *name) const
+{
+    return IsUncheckedIn(name, *availableScalarFields) || IsUncheckedIn(name, *availableExtraScalarFields);
+}
+
+QStringList LasOpenDialog::filesToMerge() const
+{
+    QStringList files;
+    if (!mergeGroupBox->isChecked())
+    {
+        return files;
+    }
+
+    for (int i = 0; i < mergeFilesList->count(); ++i)
+    {
+        files << mergeFilesList->item(i)->text();
+    }
+    return files;
+}
+
+QString LasOpenDialog::splitFieldName() const
+{
+    if (splitFieldComboBox->currentIndex() <= 0)
+    {
+        return {};
+    }
+    return splitFieldComboBox->currentText();
+}
+
+bool LasOpenDialog::shouldUseCompactStorage() const
+{
+    return compactStorageCheckBox->isEnabled() && compactStorageCheckBox->isChecked();
+}
+
+bool LasOpenDialog::shouldCreateFieldsOnDemand() const
+{
+    return onDemandFieldsCheckBox->isEnabled() && onDemandFieldsCheckBox->isChecked();
+}
+
+bool LasOpenDialog::shouldLoadProgressively() const
+{
+    return progressiveLoadCheckBox->isEnabled() && progressiveLoadCheckBox->isChecked();
+}
+
+bool LasOpenDialog::shouldDeferLoading() const
+{
+    return deferLoadingCheckBox->isEnabled() && deferLoadingCheckBox->isChecked();
+}
+
+uint64_t LasOpenDialog::memoryBudget() const
+{
+    if (!memoryBudgetSpinBox->isEnabled())
+    {
+        return 0;
+    }
+    return static_cast<uint64_t>(memoryBudgetSpinBox->value()) * 1024 * 1024;
+}
+
+uint64_t LasOpenDialog::firstPointToLoad() const
+{
+    const bool useWindow = pointWindowCheckBox->isEnabled() && pointWindowCheckBox->isChecked();
+    return useWindow ? static_cast<uint64_t>(firstPointSpinBox->value()) : 0;
+}
+
+uint64_t LasOpenDialog::lastPointToLoad() const
+{
+    // The maximum is the number of points of the file
+    const bool useWindow = pointWindowCheckBox->isEnabled() && pointWindowCheckBox->isChecked();
+    const double last = useWindow ? lastPointSpinBox->value() : lastPointSpinBox->maximum();
+    return static_cast<uint64_t>(last);
+}
+
+void LasOpenDialog::addFilesToMerge()
+{
+    const QStringList files =
+        QFileDialog::getOpenFileNames(this, "Files to merge", QString(), "LAS file (*.las *.laz)");
+    for (const QString &file : files)
+    {
+        if (mergeFilesList->findItems(file, Qt::MatchExactly).isEmpty())
+        {
+            mergeFilesList->addItem(file);
+        }
+    }
+    updateSingleCloudOptions();
+}
+
+void LasOpenDialog::removeSelectedFilesToMerge()
+{
+    qDeleteAll(mergeFilesList->selectedItems());
+    updateSingleCloudOptions();
+}
+
+void LasOpenDialog::updateSingleCloudOptions()
+{
+    const bool isSingleCloud = filesToMerge().isEmpty() && splitFieldName().isEmpty();
+    for (QWidget *option : std::initializer_list<QWidget *>{compactStorageCheckBox,
+                                                            onDemandFieldsCheckBox,
+                                                            memoryBudgetLabel,
+                                                            memoryBudgetSpinBox,
+                                                            pointWindowCheckBox,
+                                                            progressiveLoadCheckBox,
+                                                            deferLoadingCheckBox})
+    {
+        option->setEnabled(isSingleCloud);
+    }
+    const bool useWindow = isSingleCloud && pointWindowCheckBox->isChecked();
+    firstPointSpinBox->setEnabled(useWindow);
+    lastPointSpinBox->setEnabled(useWindow);
+    updateEstimates();
+}
@@ -0,0 +1,169 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasPendingDataMenu.h"
+#include "LasIOFilter.h"
+#include "LasPlaceholder.h"
+
+#include <ccMainAppInterface.h>
+#include <ccPointCloud.h>
+
+#include <QApplication>
+#include <QMainWindow>
+#include <QMenu>
+#include <QMenuBar>
+
+#include <algorithm>
+#include <memory>
+#include <vector>
+
+static const char *MenuObjectName = "LasPendingDataMenu";
+
+/// Returns the entities of the given type that are selected, or that are children of the selected entities.
+static ccHObject::Container SelectedEntitiesOfType(const ccMainAppInterface &app, CC_CLASS_ENUM type)
+{
+    ccHObject::Container entities;
+    for (ccHObject *entity : app.getSelectedEntities())
+    {
+        ccHObject::Container children;
+        if (entity->isA(type))
+        {
+            children.push_back(entity);
+        }
+        entity->filterChildren(children, true, type, true);
+        for (ccHObject *child : children)
+        {
+            if (std::find(entities.begin(), entities.end(), child) == entities.end())
+            {
+                entities.push_back(child);
+            }
+        }
+    }
+    return entities;
+}
+
+/// Loads the points of the placeholder into a new cloud that replaces it.
+static void LoadPoints(ccMainAppInterface &app, LasPlaceholder *placeholder)
+{
+    auto pointCloud = std::make_unique<ccPointCloud>();
+    if (LasIOFilter::LoadPlaceholderPoints(*placeholder, *pointCloud) != CC_FERR_NO_ERROR)
+    {
+        ccLog::Warning(QString("[LAS] Failed to load the points of '%1'").arg(placeholder->fileName()));
+        return;
+    }
+
+    ccHObject *parent = placeholder->getParent();
+    app.removeFromDB(placeholder);
+    ccPointCloud *cloud = pointCloud.release();
+    if (parent != nullptr)
+    {
+        parent->addChild(cloud);
+    }
+    app.addToDB(cloud);
+    if (!LasIOFilter::PendingFieldNames(*cloud).isEmpty())
+    {
+        LasPendingDataMenu::Install();
+    }
+    app.refreshAll();
+    app.updateUI();
+}
+
+/// Creates the scalar fields of the pending fields of the cloud, and refreshes the display.
+static void CreateFields(ccMainAppInterface &app, ccPointCloud &pointCloud, const QStringList &fieldNames)
+{
+    for (const QString &fieldName : fieldNames)
+    {
+        if (LasIOFilter::MaterializeField(pointCloud, fieldName) == CC_FERR_NO_ERROR)
+        {
+            ccLog::Print(QString("[LAS] Created '%1' of '%2'").arg(fieldName, pointCloud.getName()));
+        }
+    }
+    pointCloud.prepareDisplayForRefresh();
+    app.refreshAll();
+    app.updateUI();
+}
+
+/// Lists the pending fields of the selected clouds, one sub menu per cloud.
+static void FillMenu(QMenu &menu, ccMainAppInterface &app)
+{
+    menu.clear();
+    for (ccHObject *entity : SelectedEntitiesOfType(app, CC_TYPES::CUSTOM_H_OBJECT))
+    {
+        if (auto placeholder = dynamic_cast<LasPlaceholder *>(entity))
+        {
+            QObject::connect(menu.addAction(QString("Load the points of '%1'").arg(placeholder->getName())),
+                             &QAction::triggered,
+                             [&app, placeholder]() { LoadPoints(app, placeholder); });
+        }
+    }
+
+    for (ccHObject *entity : SelectedEntitiesOfType(app, CC_TYPES::POINT_CLOUD))
+    {
+        auto pointCloud = static_cast<ccPointCloud *>(entity);
+        const QStringList fieldNames = LasIOFilter::PendingFieldNames(*pointCloud);
+        if (fieldNames.isEmpty())
+        {
+            continue;
+        }
+
+        QMenu *cloudMenu = menu.addMenu(pointCloud->getName());
+        for (const QString &fieldName : fieldNames)
+        {
+            QObject::connect(cloudMenu->addAction(QString("Create '%1'").arg(fieldName)),
+                             &QAction::triggered,
+                             [&app, pointCloud, fieldName]()
+                             { CreateFields(app, *pointCloud, {fieldName}); });
+        }
+        cloudMenu->addSeparator();
+        QObject::connect(cloudMenu->addAction("Create all the fields"),
+                         &QAction::triggered,
+                         [&app, pointCloud, fieldNames]() { CreateFields(app, *pointCloud, fieldNames); });
+    }
+
+    if (menu.isEmpty())
+    {
+        menu.addAction("Nothing left to load in the selection")->setEnabled(false);
+    }
+}
+
+void LasPendingDataMenu::Install()
+{
+    ccMainAppInterface *app{nullptr};
+    for (QWidget *widget : QApplication::topLevelWidgets())
+    {
+        app = dynamic_cast<ccMainAppInterface *>(widget);
+        if (app != nullptr)
+        {
+            break;
+        }
+    }
+    if (app == nullptr || app->getMainWindow() == nullptr)
+    {
+        return;
+    }
+
+    QMenuBar *menuBar = app->getMainWindow()->menuBar();
+    if (menuBar->findChild<QMenu *>(MenuObjectName) != nullptr)
+    {
+        return;
+    }
+
+    auto menu = new QMenu("LAS", menuBar);
+    menu->setObjectName(MenuObjectName);
+    // The pointers to the clouds are only valid while the menu is shown, so it is rebuilt each time
+    QObject::connect(menu, &QMenu::aboutToShow, [menu, app]() { FillMenu(*menu, *app); });
+    menuBar->addMenu(menu);
+}
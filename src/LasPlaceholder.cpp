@@ -0,0 +1,53 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasPlaceholder.h"
+
+#include <QFileInfo>
+
+#include <utility>
+
+LasPlaceholder::LasPlaceholder(const QString &fileName,
+                               const ccBBox &box,
+                               const CCVector3d &shift,
+                               std::vector<LasScalarField> standardFields,
+                               std::vector<LasExtraScalarField> extraFields,
+                               LasSavedInfo savedInfo)
+    : ccCustomHObject(QString("%1 (not loaded)").arg(QFileInfo(fileName).fileName())),
+      m_fileName(fileName),
+      m_box(box),
+      m_shift(shift),
+      m_standardFields(std::move(standardFields)),
+      m_extraFields(std::move(extraFields)),
+      m_savedInfo(std::move(savedInfo))
+{
+    // Plain hierarchy objects are hidden and cannot be shown
+    lockVisibility(false);
+    setVisible(true);
+}
+
+ccBBox LasPlaceholder::getOwnBB(bool /*withGLFeatures*/)
+{
+    return m_box;
+}
+
+void LasPlaceholder::drawMeOnly(CC_DRAW_CONTEXT &context)
+{
+    if (MACRO_Draw3D(context))
+    {
+        m_box.draw(context, ccColor::yellow);
+    }
+}
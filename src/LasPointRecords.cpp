@@ -0,0 +1,218 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasPointRecords.h"
+
+#include <ccLog.h>
+
+#include <QDir>
+
+#include <cstring>
+#include <new>
+
+/// Size of the part of the record kept for a point format,
+/// this follows the layout of the LAS record without X, Y, Z, RGB and the wave packet.
+static size_t CoreRecordSize(unsigned int pointFormat)
+{
+    if (pointFormat >= 6)
+    {
+        // intensity, returns, flags, classification, user data, scan angle, point source id, gps time
+        return 18 + (HasNearInfrared(pointFormat) ? sizeof(laszip_U16) : 0);
+    }
+    // intensity, returns & flags, classification & flags, scan angle rank, user data, point source id
+    return 8 + (HasGpsTime(pointFormat) ? sizeof(laszip_F64) : 0);
+}
+
+template <typename T> static void Write(uint8_t *&dest, T value)
+{
+    std::memcpy(dest, &value, sizeof(T));
+    dest += sizeof(T);
+}
+
+template <typename T> static T Read(const uint8_t *&source)
+{
+    T value;
+    std::memcpy(&value, source, sizeof(T));
+    source += sizeof(T);
+    return value;
+}
+
+static size_t NumExtraBytes(const laszip_header &header)
+{
+    const size_t standardSize = PointFormatSize(header.point_data_format);
+    return header.point_data_record_length > standardSize ? header.point_data_record_length - standardSize
+                                                          : 0;
+}
+
+LasPointRecords::LasPointRecords(const laszip_header &header)
+    : m_pointFormat(header.point_data_format),
+      m_coreSize(CoreRecordSize(header.point_data_format)),
+      m_numExtraBytes(NumExtraBytes(header)),
+      m_recordSize(m_coreSize + m_numExtraBytes)
+{
+}
+
+size_t LasPointRecords::RecordSize(const laszip_header &header)
+{
+    return CoreRecordSize(header.point_data_format) + NumExtraBytes(header);
+}
+
+bool LasPointRecords::allocate(unsigned int numPoints)
+{
+    m_size = numPoints;
+    try
+    {
+        m_data.resize(byteSize());
+        m_records = m_data.data();
+        return true;
+    }
+    catch (const std::bad_alloc &)
+    {
+        m_data = std::vector<uint8_t>();
+    }
+
+    const qint64 fileSize = static_cast<qint64>(byteSize());
+    m_file = std::make_unique<QTemporaryFile>(QDir::temp().filePath("LAS-IO-records-XXXXXX"));
+    uchar *mapping{nullptr};
+    if (m_file->open() && m_file->resize(fileSize))
+    {
+        mapping = m_file->map(0, fileSize);
+    }
+    if (mapping == nullptr)
+    {
+        ccLog::Warning(QString("[LAS] Failed to create the temporary file of the point records: %1")
+                           .arg(m_file->errorString()));
+        m_file.reset();
+        m_size = 0;
+        return false;
+    }
+    m_records = mapping;
+    return true;
+}
+
+void LasPointRecords::store(unsigned int index, const laszip_point &point)
+{
+    Q_ASSERT(index < m_size);
+    uint8_t *dest = m_records + index * m_recordSize;
+    Write<laszip_U16>(dest, point.intensity);
+    if (m_pointFormat >= 6)
+    {
+        Write<laszip_U8>(dest, point.extended_return_number | (point.extended_number_of_returns << 4));
+        const unsigned int classificationFlags = point.extended_classification_flags | point.synthetic_flag |
+                                                 (point.keypoint_flag << 1) | (point.withheld_flag << 2);
+        Write<laszip_U8>(dest,
+                         classificationFlags | (point.extended_scanner_channel << 4) |
+                             (point.scan_direction_flag << 6) | (point.edge_of_flight_line << 7));
+        Write<laszip_U8>(dest, point.extended_classification);
+        Write<laszip_U8>(dest, point.user_data);
+        Write<laszip_I16>(dest, point.extended_scan_angle);
+        Write<laszip_U16>(dest, point.point_source_ID);
+        Write<laszip_F64>(dest, point.gps_time);
+        if (HasNearInfrared(m_pointFormat))
+        {
+            Write<laszip_U16>(dest, point.rgb[3]);
+        }
+    }
+    else
+    {
+        Write<laszip_U8>(dest,
+                         point.return_number | (point.number_of_returns << 3) |
+                             (point.scan_direction_flag << 6) | (point.edge_of_flight_line << 7));
+        Write<laszip_U8>(dest,
+                         point.classification | (point.synthetic_flag << 5) | (point.keypoint_flag << 6) |
+                             (point.withheld_flag << 7));
+        Write<laszip_I8>(dest, point.scan_angle_rank);
+        Write<laszip_U8>(dest, point.user_data);
+        Write<laszip_U16>(dest, point.point_source_ID);
+        if (HasGpsTime(m_pointFormat))
+        {
+            Write<laszip_F64>(dest, point.gps_time);
+        }
+    }
+
+    if (m_numExtraBytes != 0 && point.extra_bytes != nullptr)
+    {
+        std::memcpy(dest, point.extra_bytes, m_numExtraBytes);
+    }
+}
+
+void LasPointRecords::restore(unsigned int index, laszip_point &point) const
+{
+    Q_ASSERT(index < m_size);
+    const uint8_t *source = m_records + index * m_recordSize;
+    point.intensity = Read<laszip_U16>(source);
+    if (m_pointFormat >= 6)
+    {
+        const auto returns = Read<laszip_U8>(source);
+        point.extended_return_number = returns & 0x0F;
+        point.extended_number_of_returns = returns >> 4;
+        const auto flags = Read<laszip_U8>(source);
+        point.extended_classification_flags = flags & 0x0F;
+        point.synthetic_flag = flags & 1;
+        point.keypoint_flag = (flags >> 1) & 1;
+        point.withheld_flag = (flags >> 2) & 1;
+        point.extended_scanner_channel = (flags >> 4) & 3;
+        point.scan_direction_flag = (flags >> 6) & 1;
+        point.edge_of_flight_line = flags >> 7;
+        point.extended_classification = Read<laszip_U8>(source);
+        point.user_data = Read<laszip_U8>(source);
+        point.extended_scan_angle = Read<laszip_I16>(source);
+        point.point_source_ID = Read<laszip_U16>(source);
+        point.gps_time = Read<laszip_F64>(source);
+        if (HasNearInfrared(m_pointFormat))
+        {
+            point.rgb[3] = Read<laszip_U16>(source);
+        }
+    }
+    else
+    {
+        const auto returns = Read<laszip_U8>(source);
+        point.return_number = returns & 7;
+        point.number_of_returns = (returns >> 3) & 7;
+        point.scan_direction_flag = (returns >> 6) & 1;
+        point.edge_of_flight_line = returns >> 7;
+        const auto classification = Read<laszip_U8>(source);
+        point.classification = classification & 0x1F;
+        point.synthetic_flag = (classification >> 5) & 1;
+        point.keypoint_flag = (classification >> 6) & 1;
+        point.withheld_flag = classification >> 7;
+        point.scan_angle_rank = Read<laszip_I8>(source);
+        point.user_data = Read<laszip_U8>(source);
+        point.point_source_ID = Read<laszip_U16>(source);
+        if (HasGpsTime(m_pointFormat))
+        {
+            point.gps_time = Read<laszip_F64>(source);
+        }
+    }
+
+    point.num_extra_bytes = static_cast<laszip_I32>(m_numExtraBytes);
+    point.extra_bytes = m_numExtraBytes != 0 ? const_cast<laszip_U8 *>(source) : nullptr;
+}
+
+void LasPointRecords::resize(unsigned int numPoints)
+{
+    if (numPoints >= m_size)
+    {
+        return;
+    }
+    m_size = numPoints;
+    if (!isFileBacked())
+    {
+        m_data.resize(byteSize());
+        m_data.shrink_to_fit();
+        m_records = m_data.data();
+    }
+}
@@ -0,0 +1,171 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasPreview.h"
+#include "LasDetails.h"
+#include "LasScalarFieldLoader.h"
+
+#include <ccPointCloud.h>
+#include <ccScalarField.h>
+
+#include <laszip/laszip_api.h>
+
+#include <algorithm>
+
+/// Returns the range of the values of the scalar field, in the unit of the file.
+static LasPreview::FieldRange RangeOf(ccScalarField &sf)
+{
+    sf.computeMinAndMax();
+    LasPreview::FieldRange range;
+    range.min = sf.getMin() + sf.getGlobalShift();
+    range.max = sf.getMax() + sf.getGlobalShift();
+    return range;
+}
+
+CC_FILE_ERROR LasPreview::Compute(const QString &fileName,
+                                  LasPreview &preview,
+                                  unsigned int numRuns,
+                                  unsigned int runLength)
+{
+    laszip_POINTER laszipReader{nullptr};
+    laszip_header *laszipHeader{nullptr};
+    laszip_point *laszipPoint{nullptr};
+    laszip_BOOL isCompressed{false};
+    laszip_CHAR *errorMsg{nullptr};
+    if (laszip_create(&laszipReader))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    const auto closeReader = [laszipReader]()
+    {
+        laszip_close_reader(laszipReader);
+        laszip_clean(laszipReader);
+        laszip_destroy(laszipReader);
+    };
+
+    if (laszip_open_reader(laszipReader, qPrintable(fileName), &isCompressed) ||
+        laszip_get_header_pointer(laszipReader, &laszipHeader) ||
+        laszip_get_point_pointer(laszipReader, &laszipPoint))
+    {
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+        closeReader();
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    const uint64_t pointCount = PointCount(*laszipHeader);
+    if (pointCount <= static_cast<uint64_t>(numRuns) * runLength)
+    {
+        // Small enough to read all the points
+        numRuns = 1;
+        runLength = static_cast<unsigned int>(pointCount);
+    }
+    if (runLength == 0)
+    {
+        closeReader();
+        return CC_FERR_NO_LOAD;
+    }
+
+    ccPointCloud sampleCloud;
+    if (!sampleCloud.resize(numRuns * runLength))
+    {
+        closeReader();
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+
+    const unsigned int pointFormat = laszipHeader->point_data_format;
+    LasScalarFieldLoader loader(LasScalarFieldForPointFormat(pointFormat),
+                                LasExtraScalarField::ParseExtraScalarFields(*laszipHeader),
+                                sampleCloud);
+    const LasScalarField::Id classificationId =
+        pointFormat >= 6 ? LasScalarField::ExtendedClassification : LasScalarField::Classification;
+    preview.hasRGB = HasRGB(pointFormat);
+    laszip_U16 maxColorComponent{0};
+
+    CC_FILE_ERROR error{CC_FERR_NO_ERROR};
+    unsigned int sampleIndex{0};
+    const uint64_t runStride = pointCount / numRuns;
+    for (unsigned int run{0}; run < numRuns && error == CC_FERR_NO_ERROR; ++run)
+    {
+        if (laszip_seek_point(laszipReader, static_cast<laszip_I64>(run * runStride)))
+        {
+            error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            break;
+        }
+
+        for (unsigned int j{0}; j < runLength; ++j, ++sampleIndex)
+        {
+            if (laszip_read_point(laszipReader))
+            {
+                error = CC_FERR_THIRD_PARTY_LIB_FAILURE;
+                break;
+            }
+
+            error = loader.handleFields(sampleCloud, sampleIndex, *laszipPoint);
+            if (error != CC_FERR_NO_ERROR)
+            {
+                break;
+            }
+
+            preview.classificationCounts[static_cast<int>(
+                LasScalarField::ValueFrom(classificationId, *laszipPoint))]++;
+            if (preview.hasRGB)
+            {
+                maxColorComponent = std::max(
+                    {maxColorComponent, laszipPoint->rgb[0], laszipPoint->rgb[1], laszipPoint->rgb[2]});
+            }
+        }
+    }
+
+    if (error == CC_FERR_THIRD_PARTY_LIB_FAILURE)
+    {
+        laszip_get_error(laszipReader, &errorMsg);
+        ccLog::Warning("[LAS] laszip error: '%s'", errorMsg);
+    }
+    closeReader();
+    if (error != CC_FERR_NO_ERROR)
+    {
+        return error;
+    }
+
+    preview.numSampledPoints = sampleIndex;
+    preview.isRGB16Bits = maxColorComponent > 255;
+    for (const LasScalarField &field : loader.standardFields())
+    {
+        // The loader does not create the scalar field of fields that are all 0
+        LasPreview::FieldRange range = field.sf ? RangeOf(*field.sf) : LasPreview::FieldRange{};
+        range.name = field.name();
+        preview.fieldRanges.push_back(range);
+    }
+    for (const LasExtraScalarField &extraField : loader.extraFields())
+    {
+        LasPreview::FieldRange range;
+        range.name = extraField.name;
+        for (unsigned int i{0}; i < extraField.numElements(); ++i)
+        {
+            if (extraField.scalarFields[i] == nullptr)
+            {
+                continue;
+            }
+            const LasPreview::FieldRange elementRange = RangeOf(*extraField.scalarFields[i]);
+            range.min = i == 0 ? elementRange.min : std::min(range.min, elementRange.min);
+            range.max = i == 0 ? elementRange.max : std::max(range.max, elementRange.max);
+        }
+        preview.fieldRanges.push_back(range);
+    }
+    return CC_FERR_NO_ERROR;
+}
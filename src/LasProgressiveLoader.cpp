@@ -0,0 +1,291 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasProgressiveLoader.h"
+
+#include <ccPointCloud.h>
+#include <ccScalarField.h>
+
+#include <QElapsedTimer>
+#include <QTimer>
+
+static const char *LAS_PROGRESSIVE_LOADER_KEY = "LAS.progressiveLoader";
+
+/// Time spent reading points each time the event loop gives the hand back,
+/// short enough for the GUI to stay responsive
+constexpr qint64 BatchDurationMs = 30;
+/// Number of points of the file read between two checks of the time spent on the batch
+constexpr unsigned int NumPointsPerStep = 8192;
+
+LasProgressiveLoader::LasProgressiveLoader(laszip_POINTER laszipReader,
+                                           const laszip_header &laszipHeader,
+                                           laszip_point &laszipPoint,
+                                           ccPointCloud &pointCloud,
+                                           const CCVector3d &shift,
+                                           std::vector<LasScalarField> fields,
+                                           std::vector<LasExtraScalarField> extraFields)
+    : m_laszipReader(laszipReader),
+      m_laszipPoint(laszipPoint),
+      m_pointCount(PointCount(laszipHeader)),
+      m_pointCloud(pointCloud),
+      m_shift(shift),
+      m_fields(std::move(fields)),
+      m_extraFields(std::move(extraFields)),
+      m_hasRGB(HasRGB(laszipHeader.point_data_format))
+{
+}
+
+LasProgressiveLoader::~LasProgressiveLoader()
+{
+    closeReader();
+}
+
+void LasProgressiveLoader::closeReader()
+{
+    if (m_laszipReader == nullptr)
+    {
+        return;
+    }
+    laszip_close_reader(m_laszipReader);
+    laszip_clean(m_laszipReader);
+    laszip_destroy(m_laszipReader);
+    m_laszipReader = nullptr;
+}
+
+CC_FILE_ERROR LasProgressiveLoader::loadCoarse(unsigned int numRuns, unsigned int runLength)
+{
+    if (m_pointCount <= static_cast<uint64_t>(numRuns) * runLength)
+    {
+        numRuns = 1;
+        runLength = static_cast<unsigned int>(m_pointCount);
+    }
+    m_numRuns = numRuns;
+    m_runLength = runLength;
+    m_runStride = m_pointCount / numRuns;
+
+    if (!m_pointCloud.resize(numRuns * runLength))
+    {
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+    m_fieldLoader = std::make_unique<LasScalarFieldLoader>(m_fields, m_extraFields, m_pointCloud);
+
+    unsigned int index{0};
+    for (unsigned int run{0}; run < numRuns; ++run)
+    {
+        if (laszip_seek_point(m_laszipReader, static_cast<laszip_I64>(run * m_runStride)))
+        {
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+        for (unsigned int j{0}; j < runLength; ++j, ++index)
+        {
+            if (laszip_read_point(m_laszipReader))
+            {
+                return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+            }
+            const CC_FILE_ERROR error = m_fieldLoader->loadPoint(
+                m_laszipReader, m_laszipPoint, m_shift, m_hasRGB, m_pointCloud, index);
+            if (error != CC_FERR_NO_ERROR)
+            {
+                return error;
+            }
+        }
+    }
+
+    m_numLoadedPoints = m_pointCloud.size();
+    m_hadColors = m_pointCloud.hasColors();
+    m_isDone = m_pointCloud.size() == m_pointCount;
+    if (m_isDone)
+    {
+        closeReader();
+    }
+    return CC_FERR_NO_ERROR;
+}
+
+bool LasProgressiveLoader::isInCoarseCloud(uint64_t index) const
+{
+    return index < m_numRuns * m_runStride && index % m_runStride < m_runLength;
+}
+
+bool LasProgressiveLoader::scalarFieldsAreInCloud() const
+{
+    const auto isInCloud = [this](const ccScalarField *sf)
+    {
+        for (unsigned int i{0}; i < m_pointCloud.getNumberOfScalarFields(); ++i)
+        {
+            if (m_pointCloud.getScalarField(static_cast<int>(i)) == sf)
+            {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    for (const LasScalarField &field : m_fieldLoader->standardFields())
+    {
+        if (field.sf != nullptr && !isInCloud(field.sf))
+        {
+            return false;
+        }
+    }
+    for (const LasExtraScalarField &extraField : m_fieldLoader->extraFields())
+    {
+        for (unsigned int i{0}; i < extraField.numElements(); ++i)
+        {
+            if (extraField.scalarFields[i] != nullptr && !isInCloud(extraField.scalarFields[i]))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool LasProgressiveLoader::cloudIsUnchanged() const
+{
+    return m_pointCloud.size() == m_numLoadedPoints && m_pointCloud.hasColors() == m_hadColors &&
+           scalarFieldsAreInCloud();
+}
+
+CC_FILE_ERROR LasProgressiveLoader::loadPoints(uint64_t end)
+{
+    unsigned int numNewPoints{0};
+    for (uint64_t i{m_nextPointIndex}; i < end; ++i)
+    {
+        numNewPoints += isInCoarseCloud(i) ? 0 : 1;
+    }
+
+    unsigned int index = m_pointCloud.size();
+    if (!m_pointCloud.resize(index + numNewPoints))
+    {
+        return CC_FERR_NOT_ENOUGH_MEMORY;
+    }
+
+    for (; m_nextPointIndex < end; ++m_nextPointIndex)
+    {
+        if (laszip_read_point(m_laszipReader))
+        {
+            return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+        }
+        if (isInCoarseCloud(m_nextPointIndex))
+        {
+            continue;
+        }
+        const CC_FILE_ERROR error = m_fieldLoader->loadPoint(
+            m_laszipReader, m_laszipPoint, m_shift, m_hasRGB, m_pointCloud, index++);
+        if (error != CC_FERR_NO_ERROR)
+        {
+            return error;
+        }
+    }
+    return CC_FERR_NO_ERROR;
+}
+
+CC_FILE_ERROR LasProgressiveLoader::loadNextBatch()
+{
+    if (m_nextPointIndex == 0 && laszip_seek_point(m_laszipReader, 0))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    do
+    {
+        const CC_FILE_ERROR error =
+            loadPoints(std::min<uint64_t>(m_pointCount, m_nextPointIndex + NumPointsPerStep));
+        if (error != CC_FERR_NO_ERROR)
+        {
+            return error;
+        }
+    } while (m_nextPointIndex < m_pointCount && !timer.hasExpired(BatchDurationMs));
+
+    m_isDone = m_nextPointIndex == m_pointCount;
+    m_numLoadedPoints = m_pointCloud.size();
+    m_hadColors = m_pointCloud.hasColors();
+
+    m_pointCloud.notifyGeometryUpdate();
+    if (m_pointCloud.hasColors())
+    {
+        m_pointCloud.colorsHaveChanged();
+    }
+    m_pointCloud.redrawDisplay();
+    return CC_FERR_NO_ERROR;
+}
+
+void LasProgressiveLoader::LoadRemainingPoints(const QSharedPointer<LasProgressiveLoader> &loader)
+{
+    loader->m_pointCloud.setMetaData(LAS_PROGRESSIVE_LOADER_KEY, QVariant::fromValue(loader));
+    ScheduleNextBatch(loader);
+}
+
+void LasProgressiveLoader::ScheduleNextBatch(const QWeakPointer<LasProgressiveLoader> &weakLoader)
+{
+    QTimer::singleShot(0,
+                       [weakLoader]()
+                       {
+                           const QSharedPointer<LasProgressiveLoader> loader = weakLoader.toStrongRef();
+                           if (!loader)
+                           {
+                               // The cloud was deleted
+                               return;
+                           }
+
+                           if (!loader->cloudIsUnchanged())
+                           {
+                               ccLog::Warning("[LAS] The cloud being loaded was modified (points, colors or "
+                                              "scalar fields removed), the remaining points are not loaded");
+                               loader->finish();
+                               return;
+                           }
+
+                           const CC_FILE_ERROR error = loader->loadNextBatch();
+                           if (error != CC_FERR_NO_ERROR)
+                           {
+                               ccLog::Warning(QString("[LAS] Failed to load the remaining points (error %1), "
+                                                      "only %2 points were loaded")
+                                                  .arg(error)
+                                                  .arg(loader->m_pointCloud.size()));
+                               loader->finish();
+                               return;
+                           }
+
+                           if (loader->isDone())
+                           {
+                               loader->finish();
+                               return;
+                           }
+                           ScheduleNextBatch(weakLoader);
+                       });
+}
+
+void LasProgressiveLoader::finish()
+{
+    closeReader();
+    for (unsigned int i{0}; i < m_pointCloud.getNumberOfScalarFields(); ++i)
+    {
+        m_pointCloud.getScalarField(static_cast<int>(i))->computeMinAndMax();
+    }
+    if (m_onFinished)
+    {
+        m_onFinished(*m_fieldLoader);
+    }
+    m_pointCloud.redrawDisplay();
+    ccLog::Print(
+        QString("[LAS] '%1' is loaded (%2 points)").arg(m_pointCloud.getName()).arg(m_pointCloud.size()));
+
+    // This releases the loader once the caller drops its own reference
+    m_pointCloud.removeMetaData(LAS_PROGRESSIVE_LOADER_KEY);
+}
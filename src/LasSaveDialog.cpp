@@ -87,6 +87,8 @@ LasSaveDialog::LasSaveDialog(ccPointCloud *cloud, QWidget *parent)
             this,
             &LasSaveDialog::handleSelectedPointFormatChange);
 
+    connect(waveformCheckBox, &QCheckBox::toggled, internalWaveformCheckBox, &QCheckBox::setEnabled);
+
     for (const char *versionStr : AvailableVersions)
     {
         versionComboBox->addItem(versionStr);
@@ -225,6 +227,8 @@ void LasSaveDialog::handleSelectedPointFormatChange(int index)
     }
 
     unsigned int selectedPointFormat = (*pointFormats)[index];
+    // Only the extended point formats have a layered compression
+    layeredCompressionCheckBox->setEnabled(selectedPointFormat >= 6);
     std::vector<LasScalarField> lasScalarFields = LasScalarFieldForPointFormat(selectedPointFormat);
 
     int numDeltaFields = scalarFieldFormLayout->rowCount() - static_cast<int>(lasScalarFields.size());
@@ -249,10 +253,26 @@ void LasSaveDialog::handleSelectedPointFormatChange(int index)
 
     Q_ASSERT(lasScalarFields.size() <= scalarFieldFormLayout->rowCount());
 
+    const QString previousSplitFieldName = splitFieldComboBox->currentText();
+    splitFieldComboBox->clear();
+    splitFieldComboBox->addItem("None");
+
     QStringList cloudScalarFieldsNames = m_comboBoxModel->stringList();
     for (size_t i{0}; i < lasScalarFields.size(); ++i)
     {
         const LasScalarField &field = lasScalarFields[i];
+        switch (field.id)
+        {
+        case LasScalarField::Classification:
+        case LasScalarField::ExtendedClassification:
+        case LasScalarField::PointSourceId:
+        case LasScalarField::ExtendedScannerChannel:
+            splitFieldComboBox->addItem(field.name());
+            break;
+        default:
+            break;
+        }
+
         m_scalarFieldMapping[i].first->setName(field.name());
         m_scalarFieldMapping[i].first->clearWarning();
         m_scalarFieldMapping[i].second->setCurrentIndex(cloudScalarFieldsNames.indexOf(field.name()));
@@ -270,10 +290,13 @@ void LasSaveDialog::handleSelectedPointFormatChange(int index)
     }
 
 
+    splitFieldComboBox->setCurrentIndex(std::max(0, splitFieldComboBox->findText(previousSplitFieldName)));
+
     if (!HasRGB(selectedPointFormat) && !HasWaveform(selectedPointFormat))
     {
         specialScalarFieldFrame->hide();
         waveformCheckBox->setCheckState(Qt::Unchecked);
+        internalWaveformCheckBox->setCheckState(Qt::Unchecked);
         rgbCheckBox->setCheckState(Qt::Unchecked);
     }
     else
@@ -295,10 +318,13 @@ void LasSaveDialog::handleSelectedPointFormatChange(int index)
             waveformCheckBox->show();
             waveformCheckBox->setEnabled(m_cloud->hasFWF());
             waveformCheckBox->setChecked(m_cloud->hasFWF());
+            internalWaveformCheckBox->show();
+            internalWaveformCheckBox->setEnabled(waveformCheckBox->isChecked());
         }
         else
         {
             waveformCheckBox->hide();
+            internalWaveformCheckBox->hide();
         }
     }
 }
@@ -352,6 +378,12 @@ void LasSaveDialog::setExtraScalarFields(const std::vector<LasExtraScalarField>
     extraScalarFieldView->setModel(model);
 }
 
+void LasSaveDialog::setHasVisibilityTable(bool hasVisibilityTable)
+{
+    visiblePointsOnlyCheckBox->setEnabled(hasVisibilityTable);
+    visiblePointsOnlyCheckBox->setChecked(hasVisibilityTable);
+}
+
 unsigned int LasSaveDialog::selectedPointFormat() const
 {
     return pointFormatComboBox->currentText().toUInt();
@@ -372,6 +404,30 @@ bool LasSaveDialog::shouldSaveWaveform() const
     return waveformCheckBox->isChecked();
 }
 
+bool LasSaveDialog::shouldSaveWaveformInternally() const
+{
+    return internalWaveformCheckBox->isChecked();
+}
+
+bool LasSaveDialog::shouldSaveVisiblePointsOnly() const
+{
+    return visiblePointsOnlyCheckBox->isEnabled() && visiblePointsOnlyCheckBox->isChecked();
+}
+
+bool LasSaveDialog::shouldUseLayeredCompression() const
+{
+    return layeredCompressionCheckBox->isEnabled() && layeredCompressionCheckBox->isChecked();
+}
+
+QString LasSaveDialog::splitFieldName() const
+{
+    if (splitFieldComboBox->currentIndex() <= 0)
+    {
+        return {};
+    }
+    return splitFieldComboBox->currentText();
+}
+
 CCVector3d LasSaveDialog::chosenScale() const
 {
     const auto vectorFromString = [](const QString &string) -> CCVector3d
@@ -25,7 +25,8 @@ LasSavedInfo::LasSavedInfo(const laszip_header &header)
     : fileSourceId(header.file_source_ID), guidData1(header.project_ID_GUID_data_1),
       guidData2(header.project_ID_GUID_data_2), guidData3(header.project_ID_GUID_data_3),
       versionMinor(header.version_minor), pointFormat(header.point_data_format),
-      xScale(header.x_scale_factor), yScale(header.y_scale_factor), zScale(header.z_scale_factor)
+      xScale(header.x_scale_factor), yScale(header.y_scale_factor), zScale(header.z_scale_factor),
+      numPoints(PointCount(header))
 {
     strncpy(guidData4, header.project_ID_GUID_data_4, 8);
     strncpy(systemIdentifier, header.system_identifier, 32);
@@ -59,8 +60,8 @@ LasSavedInfo &LasSavedInfo::operator=(LasSavedInfo rhs)
 LasSavedInfo::LasSavedInfo(const LasSavedInfo &rhs)
     : fileSourceId(rhs.fileSourceId), guidData1(rhs.guidData1), guidData2(rhs.guidData2),
       guidData3(rhs.guidData3), versionMinor(rhs.versionMinor), pointFormat(rhs.pointFormat),
-      xScale(rhs.xScale), yScale(rhs.yScale), zScale(rhs.zScale), numVlrs(rhs.numVlrs),
-      extraScalarFields(rhs.extraScalarFields)
+      xScale(rhs.xScale), yScale(rhs.yScale), zScale(rhs.zScale), numPoints(rhs.numPoints),
+      numVlrs(rhs.numVlrs), extraScalarFields(rhs.extraScalarFields)
 {
 
     strncpy(guidData4, rhs.guidData4, 8);
@@ -93,6 +94,7 @@ void swap(LasSavedInfo &lhs, LasSavedInfo &rhs) noexcept
     std::swap(lhs.xScale, rhs.xScale);
     std::swap(lhs.yScale, rhs.yScale);
     std::swap(lhs.zScale, rhs.zScale);
+    std::swap(lhs.numPoints, rhs.numPoints);
     std::swap(lhs.numVlrs, rhs.numVlrs);
     std::swap(lhs.vlrs, rhs.vlrs);
     std::swap(lhs.extraScalarFields, rhs.extraScalarFields);
@@ -33,7 +33,46 @@ LasScalarFieldLoader::LasScalarFieldLoader(std::vector<LasScalarField> standardS
     createScalarFieldsForExtraBytes(pointCloud);
 }
 
+CC_FILE_ERROR LasScalarFieldLoader::loadPoint(laszip_POINTER laszipReader,
+                                              const laszip_point &currentPoint,
+                                              const CCVector3d &shift,
+                                              bool hasRGB,
+                                              ccPointCloud &pointCloud,
+                                              unsigned int pointIndex)
+{
+    laszip_F64 laszipCoordinates[3];
+    if (laszip_get_coordinates(laszipReader, laszipCoordinates))
+    {
+        return CC_FERR_THIRD_PARTY_LIB_FAILURE;
+    }
+
+    CCVector3 *point = pointCloud.point(pointIndex);
+    point->x = static_cast<PointCoordinateType>(laszipCoordinates[0] + shift.x);
+    point->y = static_cast<PointCoordinateType>(laszipCoordinates[1] + shift.y);
+    point->z = static_cast<PointCoordinateType>(laszipCoordinates[2] + shift.z);
+
+    CC_FILE_ERROR error = handleFields(pointCloud, pointIndex, currentPoint);
+    if (error == CC_FERR_NO_ERROR && hasRGB)
+    {
+        error = handleRGBValue(pointCloud, pointIndex, currentPoint);
+    }
+    return error;
+}
+
+CC_FILE_ERROR LasScalarFieldLoader::handleFields(ccPointCloud &pointCloud,
+                                                 unsigned int pointIndex,
+                                                 const laszip_point &currentPoint)
+{
+    const CC_FILE_ERROR error = handleScalarFields(pointCloud, pointIndex, currentPoint);
+    if (error != CC_FERR_NO_ERROR)
+    {
+        return error;
+    }
+    return handleExtraScalarFields(pointIndex, currentPoint);
+}
+
 CC_FILE_ERROR LasScalarFieldLoader::handleScalarFields(ccPointCloud &pointCloud,
+                                                       unsigned int pointIndex,
                                                        const laszip_point &currentPoint)
 {
     CC_FILE_ERROR error = CC_FERR_NO_ERROR;
@@ -42,66 +81,74 @@ CC_FILE_ERROR LasScalarFieldLoader::handleScalarFields(ccPointCloud &pointCloud,
         switch (lasScalarField.id)
         {
         case LasScalarField::Intensity:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.intensity);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.intensity);
             break;
         case LasScalarField::ReturnNumber:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.return_number);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.return_number);
             break;
         case LasScalarField::NumberOfReturns:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.number_of_returns);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.number_of_returns);
             break;
         case LasScalarField::ScanDirectionFlag:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.scan_direction_flag);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.scan_direction_flag);
             break;
         case LasScalarField::EdgeOfFlightLine:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.edge_of_flight_line);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.edge_of_flight_line);
             break;
         case LasScalarField::Classification:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.classification);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.classification);
             break;
         case LasScalarField::SyntheticFlag:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.synthetic_flag);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.synthetic_flag);
             break;
         case LasScalarField::KeypointFlag:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.keypoint_flag);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.keypoint_flag);
             break;
         case LasScalarField::WithheldFlag:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.withheld_flag);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.withheld_flag);
             break;
         case LasScalarField::ScanAngleRank:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.scan_angle_rank);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.scan_angle_rank);
             break;
         case LasScalarField::UserData:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.user_data);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.user_data);
             break;
         case LasScalarField::PointSourceId:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.point_source_ID);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.point_source_ID);
             break;
         case LasScalarField::GpsTime:
-            error = handleGpsTime(lasScalarField, pointCloud, currentPoint.gps_time);
+            error = handleGpsTime(lasScalarField, pointCloud, pointIndex, currentPoint.gps_time);
             break;
         case LasScalarField::ExtendedScanAngle:
-            error = handleScalarField(
-                lasScalarField, pointCloud, currentPoint.extended_scan_angle * SCAN_ANGLE_SCALE);
+            error = handleScalarField(lasScalarField,
+                                      pointCloud,
+                                      pointIndex,
+                                      currentPoint.extended_scan_angle * SCAN_ANGLE_SCALE);
             break;
         case LasScalarField::ExtendedScannerChannel:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.extended_scanner_channel);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.extended_scanner_channel);
             break;
         case LasScalarField::OverlapFlag:
-            error =
-                handleScalarField(lasScalarField, pointCloud, currentPoint.extended_classification_flags & 8);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.extended_classification_flags & 8);
             break;
         case LasScalarField::ExtendedClassification:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.extended_classification);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.extended_classification);
             break;
         case LasScalarField::ExtendedReturnNumber:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.extended_return_number);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.extended_return_number);
             break;
         case LasScalarField::ExtendedNumberOfReturns:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.extended_number_of_returns);
+            error = handleScalarField(
+                lasScalarField, pointCloud, pointIndex, currentPoint.extended_number_of_returns);
             break;
         case LasScalarField::NearInfrared:
-            error = handleScalarField(lasScalarField, pointCloud, currentPoint.rgb[3]);
+            error = handleScalarField(lasScalarField, pointCloud, pointIndex, currentPoint.rgb[3]);
             break;
         }
 
@@ -114,38 +161,39 @@ CC_FILE_ERROR LasScalarFieldLoader::handleScalarFields(ccPointCloud &pointCloud,
     return CC_FERR_NO_ERROR;
 }
 
-CC_FILE_ERROR LasScalarFieldLoader::handleRGBValue(ccPointCloud &pointCloud, const laszip_point &currentPoint)
+CC_FILE_ERROR LasScalarFieldLoader::handleRGBValue(ccPointCloud &pointCloud,
+                                                   unsigned int pointIndex,
+                                                   const laszip_point &currentPoint)
 {
-    if (!pointCloud.hasColors() && currentPoint.rgb[0] != 0)
+    const laszip_U16 anyComponent = currentPoint.rgb[0] | currentPoint.rgb[1] | currentPoint.rgb[2];
+    if (!pointCloud.hasColors())
     {
-        if (!pointCloud.reserveTheRGBTable())
-        {
-            return CC_FERR_NOT_ENOUGH_MEMORY;
-        }
-        if ((currentPoint.rgb[0] | currentPoint.rgb[1] | currentPoint.rgb[2]) > 255)
+        if (anyComponent == 0)
         {
-            colorCompShift = 8;
+            return CC_FERR_NO_ERROR;
         }
-        for (unsigned int j{0}; j < pointCloud.size() - 1; ++j)
+        // Points before this one were all black
+        if (!pointCloud.resizeTheRGBTable(false))
         {
-            auto red = static_cast<ColorCompType>(0);
-            auto green = static_cast<ColorCompType>(0);
-            auto blue = static_cast<ColorCompType>(0);
-            pointCloud.addColor(ccColor::Rgb(red, green, blue));
+            return CC_FERR_NOT_ENOUGH_MEMORY;
         }
     }
 
-    if (pointCloud.hasColors())
+    if (!colorCompShiftIsKnown && anyComponent != 0)
     {
-        auto red = static_cast<ColorCompType>(currentPoint.rgb[0] >> colorCompShift);
-        auto green = static_cast<ColorCompType>(currentPoint.rgb[1] >> colorCompShift);
-        auto blue = static_cast<ColorCompType>(currentPoint.rgb[2] >> colorCompShift);
-        pointCloud.addColor(ccColor::Rgb(red, green, blue));
+        colorCompShift = anyComponent > 255 ? 8 : 0;
+        colorCompShiftIsKnown = true;
     }
+
+    auto red = static_cast<ColorCompType>(currentPoint.rgb[0] >> colorCompShift);
+    auto green = static_cast<ColorCompType>(currentPoint.rgb[1] >> colorCompShift);
+    auto blue = static_cast<ColorCompType>(currentPoint.rgb[2] >> colorCompShift);
+    // setPointColor would notify the cloud for each point
+    pointCloud.rgbaColors()->setValue(pointIndex, ccColor::Rgba(red, green, blue, ccColor::MAX));
     return CC_FERR_NO_ERROR;
 }
 
-CC_FILE_ERROR LasScalarFieldLoader::handleExtraScalarFields(ccPointCloud &pointCloud,
+CC_FILE_ERROR LasScalarFieldLoader::handleExtraScalarFields(unsigned int pointIndex,
                                                             const laszip_point &currentPoint)
 {
     if (currentPoint.num_extra_bytes <= 0 || currentPoint.extra_bytes == nullptr)
@@ -167,13 +215,13 @@ CC_FILE_ERROR LasScalarFieldLoader::handleExtraScalarFields(ccPointCloud &pointC
         switch (extraField.kind())
         {
         case LasExtraScalarField::Unsigned:
-            handleOptionsFor(extraField, rawValues.unsignedValues);
+            handleOptionsFor(extraField, pointIndex, rawValues.unsignedValues);
             break;
         case LasExtraScalarField::Signed:
-            handleOptionsFor(extraField, rawValues.signedValues);
+            handleOptionsFor(extraField, pointIndex, rawValues.signedValues);
             break;
         case LasExtraScalarField::Floating:
-            handleOptionsFor(extraField, rawValues.floatingValues);
+            handleOptionsFor(extraField, pointIndex, rawValues.floatingValues);
             break;
         }
     }
@@ -181,66 +229,70 @@ CC_FILE_ERROR LasScalarFieldLoader::handleExtraScalarFields(ccPointCloud &pointC
 }
 
 template <typename T>
-CC_FILE_ERROR
-LasScalarFieldLoader::handleScalarField(LasScalarField &sfInfo, ccPointCloud &pointCloud, T currentValue)
+CC_FILE_ERROR LasScalarFieldLoader::handleScalarField(LasScalarField &sfInfo,
+                                                      ccPointCloud &pointCloud,
+                                                      unsigned int pointIndex,
+                                                      T currentValue)
 {
     if (!sfInfo.sf && currentValue != T{})
     {
         auto newSf = new ccScalarField(sfInfo.name());
-        sfInfo.sf = newSf;
-        pointCloud.addScalarField(newSf);
-        if (!newSf->reserveSafe(pointCloud.capacity()))
+        // Points before this one all had the default value
+        if (!newSf->resizeSafe(pointCloud.size(), true, static_cast<ScalarType>(T{})))
         {
+            newSf->release();
             return CC_FERR_NOT_ENOUGH_MEMORY;
         }
-        // addScalarField resizes the point scalarField
-        for (unsigned int j{0}; j < newSf->size() - 1; ++j)
-        {
-            newSf->setValue(j, static_cast<ScalarType>(T{}));
-        }
+        sfInfo.sf = newSf;
+        pointCloud.addScalarField(newSf);
     }
 
     if (sfInfo.sf)
     {
-        sfInfo.sf->addElement(static_cast<ScalarType>(currentValue));
+        sfInfo.sf->setValue(pointIndex, static_cast<ScalarType>(currentValue));
     }
     return CC_FERR_NO_ERROR;
 }
 
-CC_FILE_ERROR
-LasScalarFieldLoader::handleGpsTime(LasScalarField &sfInfo, ccPointCloud &pointCloud, double currentValue)
+CC_FILE_ERROR LasScalarFieldLoader::handleGpsTime(LasScalarField &sfInfo,
+                                                  ccPointCloud &pointCloud,
+                                                  unsigned int pointIndex,
+                                                  double currentValue)
 {
     if (!sfInfo.sf && currentValue != 0.0)
     {
         auto newSf = new ccScalarField(sfInfo.name());
-        sfInfo.sf = newSf;
-        pointCloud.addScalarField(newSf);
-        if (!newSf->reserveSafe(pointCloud.capacity()))
+        // Points before this one all had the default value
+        if (!newSf->resizeSafe(pointCloud.size(), true, static_cast<ScalarType>(0.0)))
         {
+            newSf->release();
             return CC_FERR_NOT_ENOUGH_MEMORY;
         }
-
         newSf->setGlobalShift(currentValue);
-
-        // addScalarField resizes the point scalarField
-        for (unsigned int j{0}; j < newSf->size() - 1; ++j)
-        {
-            newSf->setValue(j, static_cast<ScalarType>(0.0));
-        }
+        sfInfo.sf = newSf;
+        pointCloud.addScalarField(newSf);
     }
 
     if (sfInfo.sf)
     {
-        sfInfo.sf->addElement(static_cast<ScalarType>(currentValue - sfInfo.sf->getGlobalShift()));
+        sfInfo.sf->setValue(pointIndex, static_cast<ScalarType>(currentValue - sfInfo.sf->getGlobalShift()));
     }
     return CC_FERR_NO_ERROR;
 }
 
 bool LasScalarFieldLoader::createScalarFieldsForExtraBytes(ccPointCloud &pointCloud)
 {
+    // The scalar fields may be shared by the files of a merge, the points
+    // of the files that do not have the field are left without value (NaN) rather than 0
     char name[50];
     for (LasExtraScalarField &extraField : m_extraScalarFields)
     {
+        if (extraField.scalarFields[0] != nullptr)
+        {
+            // Already bound to existing scalar fields
+            continue;
+        }
+
         switch (extraField.numElements())
         {
         case 1:
@@ -255,7 +307,7 @@ bool LasScalarFieldLoader::createScalarFieldsForExtraBytes(ccPointCloud &pointCl
                 extraField.scalarFields[0] = new ccScalarField(extraField.name);
             }
 
-            if (!extraField.scalarFields[0]->reserveSafe(pointCloud.capacity()))
+            if (!extraField.scalarFields[0]->resizeSafe(pointCloud.size(), true, CCCoreLib::NAN_VALUE))
             {
                 return false;
             }
@@ -267,7 +319,8 @@ bool LasScalarFieldLoader::createScalarFieldsForExtraBytes(ccPointCloud &pointCl
             {
                 sprintf(name, "%s [%d]", extraField.name, dimIndex);
                 extraField.scalarFields[dimIndex] = new ccScalarField(name);
-                if (!extraField.scalarFields[dimIndex]->reserveSafe(pointCloud.capacity()))
+                if (!extraField.scalarFields[dimIndex]->resizeSafe(
+                        pointCloud.size(), true, CCCoreLib::NAN_VALUE))
                 {
                     return false;
                 }
@@ -376,27 +429,28 @@ void LasScalarFieldLoader::parseRawValues(const LasExtraScalarField &extraField,
     }
 }
 template <typename T>
-void LasScalarFieldLoader::handleOptionsFor(const LasExtraScalarField &extraField, T values[3])
+void LasScalarFieldLoader::handleOptionsFor(const LasExtraScalarField &extraField,
+                                            unsigned int pointIndex,
+                                            T values[3])
 {
     for (unsigned int dimIndex = 0; dimIndex < extraField.numElements(); ++dimIndex)
     {
-        if (extraField.noDataIsRelevant())
+        ccScalarField *sf = extraField.scalarFields[dimIndex];
+        if (extraField.noDataIsRelevant() &&
+            ParseValueOfTypeAs<T, T>(static_cast<const uint8_t *>(extraField.noData[dimIndex])) ==
+                values[dimIndex])
         {
-            auto noDataValue =
-                ParseValueOfTypeAs<T, T>(static_cast<const uint8_t *>(extraField.noData[dimIndex]));
-            if (noDataValue == values[dimIndex])
-            {
-                extraField.scalarFields[dimIndex]->addElement(ccScalarField::NaN());
-            }
+            sf->setValue(pointIndex, ccScalarField::NaN());
         }
         else if (extraField.scaleIsRelevant())
         {
-            extraField.scalarFields[dimIndex]->addElement(static_cast<double>(values[dimIndex]) *
-                                                          extraField.scales[dimIndex]);
+            sf->setValue(pointIndex,
+                         static_cast<ScalarType>(static_cast<double>(values[dimIndex]) *
+                                                 extraField.scales[dimIndex]));
         }
         else
         {
-            extraField.scalarFields[dimIndex]->addElement(static_cast<ScalarType>(values[dimIndex]));
+            sf->setValue(pointIndex, static_cast<ScalarType>(values[dimIndex]));
         }
     }
 }
@@ -0,0 +1,127 @@
+//##########################################################################
+//#                                                                        #
+//#                CLOUDCOMPARE PLUGIN: LAS-IO Plugin                      #
+//#                                                                        #
+//#  This program is free software; you can redistribute it and/or modify  #
+//#  it under the terms of the GNU General Public License as published by  #
+//#  the Free Software Foundation; version 2 of the License.               #
+//#                                                                        #
+//#  This program is distributed in the hope that it will be useful,       #
+//#  but WITHOUT ANY WARRANTY; without even the implied warranty of        #
+//#  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         #
+//#  GNU General Public License for more details.                          #
+//#                                                                        #
+//#                   COPYRIGHT: Thomas Montaigu                           #
+//#                                                                        #
+//##########################################################################
+#include "LasWaveformDecoder.h"
+
+#include <ccPointCloud.h>
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+
+/// Decodes `numSamples` little endian samples of type T.
+///
+/// The loop has no branches and no aliasing between input and output,
+/// so that compilers vectorize it (conversion to float and multiply-add).
+template <typename T>
+static void DecodeSamples(const uint8_t *data, uint32_t numSamples, float gain, float offset, float *out)
+{
+    for (uint32_t i{0}; i < numSamples; ++i)
+    {
+        T raw;
+        std::memcpy(&raw, data + i * sizeof(T), sizeof(T));
+        out[i] = offset + gain * static_cast<float>(qFromLittleEndian(raw));
+    }
+}
+
+LasWaveformDecoder::LasWaveformDecoder(const ccPointCloud &pointCloud) : m_pointCloud(pointCloud)
+{
+    const ccPointCloud::FWFDescriptorSet &descriptors = pointCloud.fwfDescriptors();
+    for (auto it = descriptors.constBegin(); it != descriptors.constEnd(); ++it)
+    {
+        m_descriptors[it.key()] = &it.value();
+    }
+}
+
+uint32_t LasWaveformDecoder::maxNumberOfSamples(const std::vector<unsigned int> &pointIndices) const
+{
+    const std::vector<ccWaveform> &waveforms = m_pointCloud.waveforms();
+    if (waveforms.empty())
+    {
+        return 0;
+    }
+
+    uint32_t maxNumSamples{0};
+    for (unsigned int pointIndex : pointIndices)
+    {
+        const WaveformDescriptor *descriptor = m_descriptors[waveforms[pointIndex].descriptorID()];
+        if (descriptor != nullptr)
+        {
+            maxNumSamples = std::max(maxNumSamples, descriptor->numberOfSamples);
+        }
+    }
+    return maxNumSamples;
+}
+
+uint32_t LasWaveformDecoder::decode(const std::vector<unsigned int> &pointIndices,
+                                    std::vector<float> &samples) const
+{
+    const uint32_t numSamples = maxNumberOfSamples(pointIndices);
+    samples.assign(pointIndices.size() * numSamples, 0.0f);
+    if (numSamples == 0)
+    {
+        return 0;
+    }
+
+    for (size_t i{0}; i < pointIndices.size(); ++i)
+    {
+        decodeWaveform(pointIndices[i], numSamples, samples.data() + i * numSamples);
+    }
+    return numSamples;
+}
+
+void LasWaveformDecoder::decodeWaveform(unsigned int pointIndex, uint32_t numSamples, float *row) const
+{
+    Q_ASSERT(pointIndex < m_pointCloud.size());
+    const ccWaveform &w = m_pointCloud.waveforms()[pointIndex];
+    const WaveformDescriptor *descriptor = m_descriptors[w.descriptorID()];
+    const ccPointCloud::SharedFWFDataContainer &fwfData = m_pointCloud.fwfData();
+    if (descriptor == nullptr || descriptor->bitsPerSample == 0 || fwfData == nullptr ||
+        w.byteCount() == 0 || w.dataOffset() + w.byteCount() > fwfData->size())
+    {
+        return;
+    }
+
+    // Only decode the samples actually stored for the waveform
+    const auto numStoredSamples = static_cast<uint32_t>(
+        std::min<uint64_t>({numSamples,
+                            descriptor->numberOfSamples,
+                            uint64_t(w.byteCount()) * 8 / descriptor->bitsPerSample}));
+    const uint8_t *data = fwfData->data() + w.dataOffset();
+    const auto gain = static_cast<float>(descriptor->digitizerGain);
+    const auto offset = static_cast<float>(descriptor->digitizerOffset);
+
+    switch (descriptor->bitsPerSample)
+    {
+    case 8:
+        DecodeSamples<uint8_t>(data, numStoredSamples, gain, offset, row);
+        break;
+    case 16:
+        DecodeSamples<uint16_t>(data, numStoredSamples, gain, offset, row);
+        break;
+    case 32:
+        DecodeSamples<uint32_t>(data, numStoredSamples, gain, offset, row);
+        break;
+    default:
+        // Uncommon sample widths go through CloudCompare's generic decoding
+        for (uint32_t i{0}; i < numStoredSamples; ++i)
+        {
+            row[i] = static_cast<float>(w.getSample(i, *descriptor, fwfData->data()));
+        }
+        break;
+    }
+}
@@ -19,6 +19,8 @@
 #include "LasDetails.h"
 #include "LasWaveformLoader.h"
 
+#include <algorithm>
+
 static bool parseWavepacketDescriptorVlr(const laszip_vlr_struct &vlr, WaveformDescriptor &descriptor)
 {
     if (vlr.record_length_after_header < 26)
@@ -68,16 +70,18 @@ static ccPointCloud::FWFDescriptorSet parseWaveformDescriptorVlrs(const laszip_v
     return descriptors;
 }
 
-LasWaveformLoader::LasWaveformLoader(const laszip_header_struct &laszipHeader,
-                                     const QString &lasFilename,
-                                     ccPointCloud &pointCloud)
-    : isPointFormatExtended(laszipHeader.point_data_format >= 6)
+LasWaveformLoader::LasWaveformLoader(const laszip_header_struct &laszipHeader, const QString &lasFilename)
+    : isPointFormatExtended(laszipHeader.point_data_format >= 6), m_fwfDataSource(std::make_unique<QFile>())
 {
     descriptors =
         parseWaveformDescriptorVlrs(laszipHeader.vlrs, laszipHeader.number_of_variable_length_records);
     ccLog::Print("[LAS] %d Waveform Packet Descriptor VLRs found", descriptors.size());
+    for (auto it = descriptors.constBegin(); it != descriptors.constEnd(); ++it)
+    {
+        m_isDescriptorValid[it.key()] = true;
+    }
 
-    QFile fwfDataSource;
+    QFile &fwfDataSource = *m_fwfDataSource;
     if (laszipHeader.start_of_waveform_data_packet_record != 0)
     {
         ccLog::Print("[LAS] Waveform data is located within the las file");
@@ -111,18 +115,27 @@ LasWaveformLoader::LasWaveformLoader(const laszip_header_struct &laszipHeader,
             return;
         }
         fwfDataCount = evlrHeader.recordLength;
-        fwfDataOffset = 0;
+        // The wave packet offsets are relative to the start of the EVLR header
+        fwfDataOffset = EvlrHeader::SIZE;
+        m_fwfDataStart = fwfDataSource.pos();
         if (fwfDataCount == 0)
         {
-            ccLog::Warning(QString("[LAS] Invalid waveform data packet size (0). We'll load all the "
-                                   "remaining part of the file!"));
-            fwfDataCount = fwfDataSource.size() - fwfDataSource.pos();
+            ccLog::Warning("[LAS] Invalid waveform data packet size (0), waveforms will not be loaded");
+            return;
+        }
+        if (m_fwfDataStart + fwfDataCount > static_cast<uint64_t>(fwfDataSource.size()))
+        {
+            ccLog::Warning(QString("[LAS] The waveform data packets (%1 bytes) go beyond the end of the "
+                                   "file, waveforms will not be loaded")
+                               .arg(fwfDataCount));
+            fwfDataCount = 0;
+            return;
         }
     }
     else if (laszipHeader.global_encoding & 4)
     {
         QFileInfo info(lasFilename);
-        QString wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.baseName());
+        QString wdpFilename = QString("%1/%2.wdp").arg(info.path(), info.completeBaseName());
         fwfDataSource.setFileName(wdpFilename);
         if (!fwfDataSource.open(QFile::ReadOnly))
         {
@@ -143,73 +156,71 @@ LasWaveformLoader::LasWaveformLoader(const laszip_header_struct &laszipHeader,
             if (evlrHeader.isWaveFormDataPackets())
             {
                 // this is a valid EVLR header, we can skip it
-                auto p = fwfDataSource.pos();
                 fwfDataCount -= EvlrHeader::SIZE;
                 fwfDataOffset = EvlrHeader::SIZE;
-            }
-            else
-            {
-                // this doesn't look like a valid EVLR
-                fwfDataSource.seek(0);
+                m_fwfDataStart = EvlrHeader::SIZE;
             }
         }
         ccLog::Print(
             QString("[LAS] Waveform Data Packets are in an external file located at %1").arg(wdpFilename));
     }
 
-    if (fwfDataSource.isOpen() && fwfDataCount != 0)
+    if (!fwfDataSource.isOpen())
     {
-        ccPointCloud::FWFDataContainer *container{nullptr};
-        try
-        {
-            container = new ccPointCloud::FWFDataContainer;
-            container->resize(fwfDataCount);
-            pointCloud.waveforms().resize(pointCloud.capacity());
-        }
-        catch (const std::bad_alloc &)
-        {
-            ccLog::Warning(QString("[LAS] Not enough memory to import the waveform data"));
-            delete container;
-            return;
-        }
+        fwfDataCount = 0;
+    }
+}
 
-        fwfDataSource.read((char *)container->data(), fwfDataCount);
-        fwfDataSource.close();
+bool LasWaveformLoader::prepare(ccPointCloud &pointCloud) const
+{
+    if (fwfDataCount == 0)
+    {
+        return true;
+    }
 
-        pointCloud.fwfData() = ccPointCloud::SharedFWFDataContainer(container);
+    // All the descriptors are given to the cloud upfront,
+    // so that points do not have to check whether the cloud has theirs
+    for (auto it = descriptors.constBegin(); it != descriptors.constEnd(); ++it)
+    {
+        pointCloud.fwfDescriptors().insert(it.key(), it.value());
     }
+
+    try
+    {
+        pointCloud.waveforms().resize(pointCloud.size());
+    }
+    catch (const std::bad_alloc &)
+    {
+        ccLog::Warning(QString("[LAS] Not enough memory to import the waveform data"));
+        return false;
+    }
+    return true;
 }
 
-void LasWaveformLoader::loadWaveform(ccPointCloud &pointCloud, const laszip_point &currentPoint) const
+void LasWaveformLoader::loadWaveform(ccPointCloud &pointCloud,
+                                     unsigned int pointIndex,
+                                     const laszip_point &currentPoint) const
 {
-    Q_ASSERT(pointCloud.size() > 0);
+    Q_ASSERT(pointIndex < pointCloud.size());
     if (fwfDataCount == 0)
     {
         return;
     }
 
-    auto data = QByteArray::fromRawData(reinterpret_cast<const char *>(currentPoint.wave_packet), 29);
-    QDataStream stream(data);
-    stream.setByteOrder(QDataStream::ByteOrder::LittleEndian);
-
-    uint8_t descriptorIndex;
-    quint64 byteOffset;
-    uint32_t byteCount;
-    float returnPointLocation;
-    float x_t, y_t, z_t;
-    stream >> descriptorIndex >> byteOffset >> byteCount >> returnPointLocation >> x_t >> y_t >> z_t;
-
-    ccPointCloud::FWFDescriptorSet &cloudDescriptors = pointCloud.fwfDescriptors();
-    if (descriptors.contains(descriptorIndex) && !cloudDescriptors.contains(descriptorIndex))
+    const LasWavePacket packet = LasWavePacket::Decode(currentPoint.wave_packet);
+    if (packet.descriptorIndex == 0)
     {
-        cloudDescriptors.insert(descriptorIndex, descriptors.value(descriptorIndex));
+        // This point has no waveform
+        return;
     }
-    else if (!descriptors.contains(descriptorIndex))
+    if (!m_isDescriptorValid[packet.descriptorIndex])
     {
-        ccLog::Warning("[LAS] No valid descriptor vlr for index %d", descriptorIndex);
+        ccLog::Warning("[LAS] No valid descriptor vlr for index %d", packet.descriptorIndex);
         return;
     }
 
+    uint64_t byteOffset = packet.byteOffset;
+    uint32_t byteCount = packet.byteCount;
     if (byteOffset < fwfDataOffset)
     {
         ccLog::Warning("[LAS] Waveform byte offset is smaller that fwfDataOffset");
@@ -218,19 +229,23 @@ void LasWaveformLoader::loadWaveform(ccPointCloud &pointCloud, const laszip_poin
 
     byteOffset -= fwfDataOffset;
 
-    if (byteOffset + byteCount > fwfDataCount)
+    if (byteOffset >= fwfDataCount)
     {
-        ccLog::Warning("[LAS] Waveform byte count for point %u is bigger than actual fwf data",
-                       pointCloud.size() - 1);
-        byteCount = (fwfDataCount - byteOffset);
+        ccLog::Warning("[LAS] Waveform byte offset for point %u is beyond the actual fwf data", pointIndex);
+        return;
+    }
+    if (byteCount > fwfDataCount - byteOffset)
+    {
+        ccLog::Warning("[LAS] Waveform byte count for point %u is bigger than actual fwf data", pointIndex);
+        byteCount = static_cast<uint32_t>(fwfDataCount - byteOffset);
     }
 
-    ccWaveform &w = pointCloud.waveforms()[pointCloud.size() - 1];
+    ccWaveform &w = pointCloud.waveforms()[pointIndex];
 
-    w.setDescriptorID(descriptorIndex);
+    w.setDescriptorID(packet.descriptorIndex);
     w.setDataDescription(byteOffset, byteCount);
-    w.setEchoTime_ps(returnPointLocation);
-    w.setBeamDir(CCVector3f(x_t, y_t, z_t));
+    w.setEchoTime_ps(packet.returnPointLocation);
+    w.setBeamDir(CCVector3f(packet.xt, packet.yt, packet.zt));
 
     if (isPointFormatExtended)
     {
@@ -241,3 +256,106 @@ void LasWaveformLoader::loadWaveform(ccPointCloud &pointCloud, const laszip_poin
         w.setReturnIndex(currentPoint.return_number);
     }
 }
+
+bool LasWaveformLoader::readData(uint64_t offset, uint64_t count, uint8_t *dest)
+{
+    // Reading everything at once would require the OS to handle a single huge request
+    constexpr uint64_t ChunkSize = 64 * 1024 * 1024;
+
+    if (!m_fwfDataSource->seek(m_fwfDataStart + offset))
+    {
+        ccLog::Warning(
+            QString("[LAS] Failed to read the waveform data: %1").arg(m_fwfDataSource->errorString()));
+        return false;
+    }
+
+    while (count != 0)
+    {
+        const qint64 chunkSize = static_cast<qint64>(std::min(count, ChunkSize));
+        if (m_fwfDataSource->read(reinterpret_cast<char *>(dest), chunkSize) != chunkSize)
+        {
+            ccLog::Warning(
+                QString("[LAS] Failed to read the waveform data: %1").arg(m_fwfDataSource->errorString()));
+            return false;
+        }
+        dest += chunkSize;
+        count -= chunkSize;
+    }
+    return true;
+}
+
+bool LasWaveformLoader::transferDataTo(const std::vector<ccPointCloud *> &pointClouds)
+{
+    if (fwfDataCount == 0)
+    {
+        return true;
+    }
+
+    bool success{true};
+    try
+    {
+        WaveformDataRanges ranges;
+        for (const ccPointCloud *pointCloud : pointClouds)
+        {
+            for (const ccWaveform &w : pointCloud->waveforms())
+            {
+                ranges.add(w.dataOffset(), w.byteCount());
+            }
+        }
+        ranges.merge();
+
+        auto container = std::make_unique<ccPointCloud::FWFDataContainer>();
+        container->resize(ranges.compactedSize());
+        for (const WaveformDataRanges::Range &range : ranges.ranges())
+        {
+            uint8_t *dest = container->data() + range.compactedStart;
+            if (!readData(range.begin, range.end - range.begin, dest))
+            {
+                success = false;
+                break;
+            }
+        }
+
+        if (success)
+        {
+            ccPointCloud::SharedFWFDataContainer sharedContainer(container.release());
+            for (ccPointCloud *pointCloud : pointClouds)
+            {
+                for (ccWaveform &w : pointCloud->waveforms())
+                {
+                    if (w.byteCount() != 0)
+                    {
+                        w.setDataDescription(ranges.compactedOffset(w.dataOffset()), w.byteCount());
+                    }
+                }
+                pointCloud->fwfData() = sharedContainer;
+            }
+
+            if (ranges.compactedSize() < fwfDataCount)
+            {
+                ccLog::Print(
+                    QString("[LAS] %1 bytes of waveform data out of %2 are used by the loaded points")
+                        .arg(ranges.compactedSize())
+                        .arg(fwfDataCount));
+            }
+        }
+    }
+    catch (const std::bad_alloc &)
+    {
+        ccLog::Warning(QString("[LAS] Not enough memory to import the waveform data"));
+        success = false;
+    }
+
+    if (!success)
+    {
+        for (ccPointCloud *pointCloud : pointClouds)
+        {
+            pointCloud->waveforms().clear();
+            pointCloud->fwfDescriptors().clear();
+        }
+    }
+
+    m_fwfDataSource->close();
+    fwfDataCount = 0;
+    return success;
+}
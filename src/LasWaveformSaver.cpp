@@ -19,25 +19,28 @@
 #include <LasDetails.h>
 #include <ccPointCloud.h>
 
-LasWaveformSaver::LasWaveformSaver(const ccPointCloud &pointCloud) noexcept
-    : m_array(29, '\0'), m_pointCloud(pointCloud)
+LasWaveformSaver::LasWaveformSaver(const ccPointCloud &pointCloud,
+                                   const WaveformDataRanges &dataRanges) noexcept
+    : m_pointCloud(pointCloud), m_dataRanges(dataRanges)
 {
 }
 
 void LasWaveformSaver::handlePoint(size_t index, laszip_point &point)
 {
     Q_ASSERT(index < m_pointCloud.size());
-    const ccWaveform w = m_pointCloud.waveforms()[index];
+    const ccWaveform &w = m_pointCloud.waveforms()[index];
 
+    LasWavePacket packet;
+    packet.descriptorIndex = w.descriptorID();
+    packet.byteOffset = EvlrHeader::SIZE;
+    if (w.byteCount() != 0)
     {
-        QDataStream stream(&m_array, QIODevice::WriteOnly);
-        stream.setByteOrder(QDataStream::ByteOrder::LittleEndian);
-        stream << w.descriptorID();
-        stream << static_cast<quint64>(w.dataOffset() + EvlrHeader::SIZE);
-        stream << w.byteCount();
-        stream << w.echoTime_ps();
-        stream << w.beamDir().x << w.beamDir().y << w.beamDir().z;
+        packet.byteOffset += m_dataRanges.compactedOffset(w.dataOffset());
     }
-
-    memcpy(point.wave_packet, m_array.constData(), 29);
-}
\ No newline at end of file
+    packet.byteCount = w.byteCount();
+    packet.returnPointLocation = w.echoTime_ps();
+    packet.xt = w.beamDir().x;
+    packet.yt = w.beamDir().y;
+    packet.zt = w.beamDir().z;
+    packet.encode(point.wave_packet);
+}